@@ -0,0 +1,282 @@
+/** @main main.c
+ * @brief IPC microbenchmark of the pipeline channel transports.
+ *
+ *
+ * Threads A, B and C are connected like the fifo and ShareMem pipelines
+ * (A -> B -> C) through channels of the transport selected in Kconfig (see
+ * channel.h). For payloads of 2, 20 and 200 bytes it measures:
+ * - the handoff latency of each hop (min/avg/p99), with one item in the
+ *   pipeline at a time;
+ * - the saturated throughput, with A sending back to back and handing the
+ *   CPU to B after each item, as equal priority pipeline threads do.
+ *
+ * Build it once per transport (see the overlays), on qemu or on hardware.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ * @bug There are no bugs
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <string.h>
+#include <timing/timing.h>
+
+/** Inter-stage transport (see common/channel.h) */
+#include "channel.h"
+
+/** Items sent through the pipeline per measurement */
+#define BENCH_ITEMS CONFIG_APP_BENCH_ITEMS
+/** Largest payload (bytes) */
+#define BENCH_MAX_PAYLOAD 200
+
+BUILD_ASSERT(BENCH_ITEMS <= UINT16_MAX, "item numbers must fit in the 2-byte payload");
+
+/** Size of stack area used by each thread (can be thread specific)*/
+#define STACK_SIZE 1024
+
+/** Thread scheduling priority, the same for the three stages as in the pipelines */
+#define thread_prio 1
+
+/** Create thread stack space */
+K_THREAD_STACK_DEFINE(thread_A_stack, STACK_SIZE);
+/** Create thread stack space */
+K_THREAD_STACK_DEFINE(thread_B_stack, STACK_SIZE);
+/** Create thread stack space */
+K_THREAD_STACK_DEFINE(thread_C_stack, STACK_SIZE);
+
+/* Create variables for thread data */
+struct k_thread thread_A_data;
+struct k_thread thread_B_data;
+struct k_thread thread_C_data;
+
+/* Create channels, one pair per payload size. Items are handed over one at a time. */
+CHANNEL_DEFINE(ab_2, 2, 1, CHANNEL_DEPTH);
+CHANNEL_DEFINE(bc_2, 2, 1, CHANNEL_DEPTH);
+CHANNEL_DEFINE(ab_20, 20, 1, CHANNEL_DEPTH);
+CHANNEL_DEFINE(bc_20, 20, 1, CHANNEL_DEPTH);
+CHANNEL_DEFINE(ab_200, 200, 1, CHANNEL_DEPTH);
+CHANNEL_DEFINE(bc_200, 200, 1, CHANNEL_DEPTH);
+
+/** One payload size and its channels */
+struct bench_case {
+    uint16_t size;          /* Payload (bytes); the first two carry the item number */
+    struct channel *ab;
+    struct channel *bc;
+};
+
+static const struct bench_case cases[] = {
+    { 2, &ab_2, &bc_2 },
+    { 20, &ab_20, &bc_20 },
+    { BENCH_MAX_PAYLOAD, &ab_200, &bc_200 },
+};
+
+/** Latency, throughput and lost items of one payload size */
+struct bench_result {
+    uint32_t min[2];        /* Per hop (A->B, B->C), ns */
+    uint32_t avg[2];
+    uint32_t p99[2];
+    uint32_t items_s;       /* Saturated throughput, items per second */
+    uint32_t dropped;       /* Items that never reached C (saturated) */
+};
+
+/* Measurement in progress, set by thread A before it starts B and C */
+static const struct bench_case *cur;
+static bool saturated;
+
+/* Timestamps of each item: sent by A, received by B, received by C */
+static timing_t t_a[BENCH_ITEMS];
+static timing_t t_b[BENCH_ITEMS];
+static timing_t t_c[BENCH_ITEMS];
+/* Latencies of one hop (ns), sorted for the percentile */
+static uint32_t lat[BENCH_ITEMS];
+/* Items received by C in the last measurement */
+static uint32_t received;
+
+/* Semaphores for task synch */
+K_SEM_DEFINE(start_b, 0, 1);
+K_SEM_DEFINE(start_c, 0, 1);
+K_SEM_DEFINE(item_done, 0, 1);
+K_SEM_DEFINE(run_done, 0, 1);
+
+/* Thread code prototypes */
+void thread_A_code(void *, void *, void *);
+void thread_B_code(void *, void *, void *);
+void thread_C_code(void *, void *, void *);
+
+/** Sends one item, retrying while a ring refuses it */
+static void bench_send(struct channel *ch, const void *item)
+{
+    while(channel_send(ch, item) == -ENOBUFS) {
+        k_yield();
+    }
+}
+
+/** Item number carried by a payload */
+static uint16_t bench_seq(const uint8_t *item)
+{
+    uint16_t seq;
+
+    memcpy(&seq, item, sizeof(seq));
+    return seq;
+}
+
+/** Min, average and 99th percentile of the latency from[i] -> to[i], in ns */
+static void bench_hop(const timing_t *from, const timing_t *to, struct bench_result *res, int hop)
+{
+    uint64_t sum = 0;
+    uint32_t v;
+    int i, j, gap;
+
+    for(i = 0; i < BENCH_ITEMS; i++) {
+        lat[i] = (uint32_t)timing_cycles_to_ns(timing_cycles_get((timing_t *)&from[i], (timing_t *)&to[i]));
+        sum += lat[i];
+    }
+
+    /* Shell sort, no heap or libc qsort needed */
+    for(gap = BENCH_ITEMS / 2; gap > 0; gap /= 2) {
+        for(i = gap; i < BENCH_ITEMS; i++) {
+            v = lat[i];
+            for(j = i; j >= gap && lat[j - gap] > v; j -= gap) {
+                lat[j] = lat[j - gap];
+            }
+            lat[j] = v;
+        }
+    }
+
+    res->min[hop] = lat[0];
+    res->avg[hop] = (uint32_t)(sum / BENCH_ITEMS);
+    /* Nearest rank: the smallest value not exceeded by 99 % of the items */
+    res->p99[hop] = lat[(BENCH_ITEMS * 99 + 99) / 100 - 1];
+}
+
+/** Main function */
+void main(void) {
+
+    /* Welcome message */
+    printk("\n\r IPC benchmark via %s, %d items per measurement \n\r", CHANNEL_TRANSPORT, BENCH_ITEMS);
+
+    timing_init();
+    timing_start();
+
+    /* Init channels */
+    for(int i = 0; i < ARRAY_SIZE(cases); i++) {
+        channel_init(cases[i].ab);
+        channel_init(cases[i].bc);
+    }
+
+    /* Create tasks */
+    k_thread_create(&thread_A_data, thread_A_stack,
+        K_THREAD_STACK_SIZEOF(thread_A_stack), thread_A_code,
+        NULL, NULL, NULL, thread_prio, 0, K_NO_WAIT);
+
+    k_thread_create(&thread_B_data, thread_B_stack,
+        K_THREAD_STACK_SIZEOF(thread_B_stack), thread_B_code,
+        NULL, NULL, NULL, thread_prio, 0, K_NO_WAIT);
+
+    k_thread_create(&thread_C_data, thread_C_stack,
+        K_THREAD_STACK_SIZEOF(thread_C_stack), thread_C_code,
+        NULL, NULL, NULL, thread_prio, 0, K_NO_WAIT);
+
+    return;
+}
+
+/** Thread A code implementation.
+ * It runs both measurements for every payload size and prints the results. */
+void thread_A_code(void *argA , void *argB, void *argC)
+{
+    uint8_t __aligned(4) item[BENCH_MAX_PAYLOAD];
+    struct bench_result res;
+    uint64_t ns;
+
+    /* Filler, so every payload byte is actually copied */
+    for(int i = 0; i < BENCH_MAX_PAYLOAD; i++) {
+        item[i] = (uint8_t)i;
+    }
+
+    printk("payload |      A->B min/avg/p99 (ns) |      B->C min/avg/p99 (ns) |  items/s | dropped\n");
+
+    for(int n = 0; n < ARRAY_SIZE(cases); n++) {
+        cur = &cases[n];
+
+        /* Handoff latency: the next item is sent when C has the previous one */
+        saturated = false;
+        k_sem_give(&start_b);
+        k_sem_give(&start_c);
+        for(uint16_t seq = 0; seq < BENCH_ITEMS; seq++) {
+            memcpy(item, &seq, sizeof(seq));
+            t_a[seq] = timing_counter_get();
+            bench_send(cur->ab, item);
+            k_sem_take(&item_done, K_FOREVER);
+        }
+        k_sem_take(&run_done, K_FOREVER);
+        bench_hop(t_a, t_b, &res, 0);
+        bench_hop(t_b, t_c, &res, 1);
+
+        /* Saturated throughput: back to back, from the first send to the
+         * arrival of the last item at C */
+        saturated = true;
+        k_sem_give(&start_b);
+        k_sem_give(&start_c);
+        for(uint16_t seq = 0; seq < BENCH_ITEMS; seq++) {
+            memcpy(item, &seq, sizeof(seq));
+            if(seq == 0) {
+                t_a[0] = timing_counter_get();
+            }
+            bench_send(cur->ab, item);
+            k_yield();
+        }
+        k_sem_take(&run_done, K_FOREVER);
+        ns = timing_cycles_to_ns(timing_cycles_get(&t_a[0], &t_c[BENCH_ITEMS - 1]));
+        res.items_s = (uint32_t)((uint64_t)received * 1000000000U / MAX(ns, 1));
+        res.dropped = BENCH_ITEMS - received;
+
+        printk("%5u B | %8u %8u %8u | %8u %8u %8u | %8u | %u\n", cur->size,
+               res.min[0], res.avg[0], res.p99[0], res.min[1], res.avg[1], res.p99[1],
+               res.items_s, res.dropped);
+    }
+
+    printk("Done\n");
+}
+
+/** Thread B code implementation.
+ * It forwards every item it receives from A to C. */
+void thread_B_code(void *argA , void *argB, void *argC)
+{
+    uint8_t __aligned(4) item[BENCH_MAX_PAYLOAD];
+    uint16_t seq;
+
+    while(1) {
+        k_sem_take(&start_b, K_FOREVER);
+        /* Shared memory may skip items; the last one always arrives */
+        do {
+            channel_recv(cur->ab, item, K_FOREVER);
+            seq = bench_seq(item);
+            t_b[seq] = timing_counter_get();
+            bench_send(cur->bc, item);
+        } while(seq != BENCH_ITEMS - 1);
+    }
+}
+
+/** Thread C code implementation.
+ * It takes the items from B and tells A when each one, and the last one, arrived. */
+void thread_C_code(void *argA , void *argB, void *argC)
+{
+    uint8_t __aligned(4) item[BENCH_MAX_PAYLOAD];
+    uint16_t seq;
+
+    while(1) {
+        k_sem_take(&start_c, K_FOREVER);
+        received = 0;
+        do {
+            channel_recv(cur->bc, item, K_FOREVER);
+            seq = bench_seq(item);
+            t_c[seq] = timing_counter_get();
+            received++;
+            if(!saturated) {
+                k_sem_give(&item_done);
+            }
+        } while(seq != BENCH_ITEMS - 1);
+        k_sem_give(&run_done);
+    }
+}
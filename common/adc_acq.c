@@ -0,0 +1,838 @@
+/** @file adc_acq.c
+ * @brief ADC acquisition layer implementation.
+ *
+ * Single mode uses the Zephyr ADC driver with one blocking adc_read() per
+ * call. Async mode starts the same conversion with adc_read_async() and
+ * lets thread A collect it later through a k_poll_signal; two buffers
+ * alternate, so thread A hands on one result while the next converts. Block mode also
+ * goes through the driver, but each adc_read_async() covers a whole block
+ * (extra_samplings) and two buffers alternate so that block N+1 is being
+ * converted while block N is processed.
+ * Hardware-timed mode bypasses the driver: TIMER2 compare events are
+ * routed to the SAADC SAMPLE task through PPI and EasyDMA writes the results
+ * into two ping-pong buffers, so the CPU is only woken once per block.
+ * Timer mode uses the same SAADC setup, but each scan is triggered by
+ * software from a k_timer expiry function through adc_acq_trigger().
+ * In every mode the block is corrected (per-channel offset and gain) and
+ * out-of-range readings are flagged before it is handed to thread A.
+ * Block, hardware-timed and timer modes convert into a pool of reference
+ * counted buffers, so a block can travel down the pipeline by pointer and
+ * is only reused once its last consumer has released it.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <devicetree.h>
+#include <sys/printk.h>
+#include <drivers/adc.h>
+#include <timing/timing.h>
+#include <sys/atomic.h>
+
+#include "adc_acq.h"
+
+/** ADC definitions and includes */
+#include <hal/nrf_saadc.h>
+/** ADC definitions and includes */
+#define ADC_NID DT_NODELABEL(adc)
+/** ADC definitions and includes */
+#define ADC_RESOLUTION 10
+/** ADC definitions and includes */
+#define ADC_GAIN ADC_GAIN_1_4
+/** ADC definitions and includes */
+#define ADC_REFERENCE ADC_REF_VDD_1_4
+/** ADC definitions and includes */
+#define ADC_ACQUISITION_TIME ADC_ACQ_TIME(ADC_ACQ_TIME_MICROSECONDS, CONFIG_APP_ACQ_ACQUISITION_TIME_US)
+/** ADC definitions and includes */
+#define ADC_OVERSAMPLING CONFIG_APP_ACQ_OVERSAMPLING
+
+/** Channel table: SAADC channel n samples input AINn. Only the channels set
+ * in ADC_ACQ_CHANNEL_MASK are configured and scanned. Note that a channel can
+ * be assigned to any ANx.*/
+static const nrf_saadc_input_t acq_channel_input[ADC_ACQ_MAX_CHANNELS] = {
+    NRF_SAADC_INPUT_AIN0, NRF_SAADC_INPUT_AIN1, NRF_SAADC_INPUT_AIN2, NRF_SAADC_INPUT_AIN3,
+    NRF_SAADC_INPUT_AIN4, NRF_SAADC_INPUT_AIN5, NRF_SAADC_INPUT_AIN6, NRF_SAADC_INPUT_AIN7,
+};
+
+BUILD_ASSERT(ADC_ACQ_CHANNEL_MASK & BIT(CONFIG_APP_ACQ_LED_CHANNEL_ID),
+             "The LED channel must be enabled in APP_ACQ_CHANNEL_MASK");
+BUILD_ASSERT(ADC_ACQ_BLOCK_SIZE % ADC_ACQ_DECIMATION == 0,
+             "APP_ACQ_DECIMATION must divide APP_ACQ_BLOCK_SIZE");
+
+/** Samples (all channels) held by one block buffer */
+#define ACQ_BUFFER_LEN (ADC_ACQ_BLOCK_SIZE * ADC_ACQ_NUM_CHANNELS)
+
+/** Linear correction of one channel */
+struct acq_correction {
+    int16_t offset;     /* Subtracted from the raw code */
+    uint16_t gain;      /* Q14, ADC_ACQ_GAIN_ONE is unity */
+};
+
+/** Correction of each channel, indexed by position within the scan */
+static struct acq_correction acq_correction[ADC_ACQ_NUM_CHANNELS] = {
+    [0 ... ADC_ACQ_NUM_CHANNELS - 1] = { 0, ADC_ACQ_GAIN_ONE },
+};
+
+int adc_acq_set_correction(uint8_t id, int16_t offset, uint16_t gain)
+{
+    struct acq_correction *corr;
+
+    if (id >= ADC_ACQ_MAX_CHANNELS || !(ADC_ACQ_CHANNEL_MASK & BIT(id))) {
+        return -EINVAL;
+    }
+    corr = &acq_correction[ADC_ACQ_CHANNEL_INDEX(id)];
+    corr->offset = offset;
+    corr->gain = gain;
+    return 0;
+}
+
+/** Most negative code still taken as 0 V. A single-ended input at ground
+ * reads a few codes either side of 0 (noise and residual offset). */
+#define ACQ_NEGATIVE_MARGIN 16
+
+/** Corrects a block in place and flags out-of-range readings with
+ * ADC_ACQ_INVALID. Integer only, no branch on the sample value.
+ * Returns the number of invalid samples. */
+static uint16_t acq_correct_block(uint16_t *samples, uint16_t count)
+{
+    uint16_t invalid = 0;
+
+    for (uint16_t k = 0; k < count; k++) {
+        for (uint8_t c = 0; c < ADC_ACQ_NUM_CHANNELS; c++, samples++) {
+            /* Single-ended results are signed; small negative codes clamp to 0 */
+            int32_t raw = (int16_t)*samples;
+            int32_t v = ((raw - acq_correction[c].offset) * acq_correction[c].gain +
+                         ADC_ACQ_GAIN_ONE / 2) >> 14;
+            int bad = (raw < -ACQ_NEGATIVE_MARGIN) | (raw > ADC_ACQ_MAX_VALUE);
+
+            *samples = bad ? ADC_ACQ_INVALID : (uint16_t)CLAMP(v, 0, ADC_ACQ_MAX_VALUE);
+            invalid += bad;
+        }
+    }
+    return invalid;
+}
+
+#if defined(CONFIG_APP_ACQ_STATS)
+
+/** Throughput and load accounting, reported every CONFIG_APP_ACQ_STATS_PERIOD_MS */
+static struct {
+    timing_t last_exit;         /* Return from the previous adc_acq_wait() */
+    timing_t idle_enter;        /* adc_acq_idle_begin() */
+    uint64_t idle_cycles;       /* Thread A asleep until its release since last_exit */
+    uint64_t busy_cycles;       /* Thread A time spent outside adc_acq_wait(), asleep excluded */
+    uint64_t total_cycles;      /* Wall time covered by the counted blocks */
+    uint32_t samples;           /* Samples delivered since the last report */
+    int64_t report_time;        /* Uptime of the next report (ms) */
+} acq_stats;
+
+/** Cycle counter used to time thread A around adc_acq_wait() */
+static inline timing_t acq_stats_now(void)
+{
+    return timing_counter_get();
+}
+
+static void acq_stats_init(void)
+{
+    timing_init();
+    timing_start();
+    acq_stats.last_exit = timing_counter_get();
+    acq_stats.report_time = k_uptime_get() + CONFIG_APP_ACQ_STATS_PERIOD_MS;
+}
+
+/** Accounts one block; enter is the counter value sampled when thread A called adc_acq_wait() */
+static void acq_stats_block(timing_t enter, uint16_t count)
+{
+    timing_t now = timing_counter_get();
+    uint64_t total_ns;
+    uint64_t busy = timing_cycles_get(&acq_stats.last_exit, &enter);
+
+    acq_stats.busy_cycles += busy - MIN(busy, acq_stats.idle_cycles);
+    acq_stats.idle_cycles = 0;
+    acq_stats.total_cycles += timing_cycles_get(&acq_stats.last_exit, &now);
+    acq_stats.samples += count;
+    acq_stats.last_exit = now;
+
+    if (k_uptime_get() < acq_stats.report_time) {
+        return;
+    }
+
+    total_ns = timing_cycles_to_ns(acq_stats.total_cycles);
+    if (total_ns) {
+        uint32_t load = (uint32_t)((acq_stats.busy_cycles * 1000) / acq_stats.total_cycles);
+
+        printk("ADC: %d ch x %d scans/block, 2^%d oversampling, %u scans/s, thread A load %u.%u%%\n",
+               ADC_ACQ_NUM_CHANNELS, ADC_ACQ_BLOCK_SIZE, ADC_OVERSAMPLING,
+               (uint32_t)(((uint64_t)acq_stats.samples * 1000000000ULL) / total_ns),
+               load / 10, load % 10);
+    }
+    acq_stats.busy_cycles = 0;
+    acq_stats.total_cycles = 0;
+    acq_stats.samples = 0;
+    acq_stats.report_time += CONFIG_APP_ACQ_STATS_PERIOD_MS;
+}
+
+void adc_acq_idle_begin(void)
+{
+    acq_stats.idle_enter = timing_counter_get();
+}
+
+void adc_acq_idle_end(void)
+{
+    timing_t now = timing_counter_get();
+
+    acq_stats.idle_cycles += timing_cycles_get(&acq_stats.idle_enter, &now);
+}
+
+#else
+
+static inline timing_t acq_stats_now(void) { return 0; }
+static inline void acq_stats_init(void) { }
+static inline void acq_stats_block(timing_t enter, uint16_t count) { }
+
+#endif /* CONFIG_APP_ACQ_STATS */
+
+#if defined(CONFIG_APP_ACQ_HW_TIMED) || defined(CONFIG_APP_ACQ_TIMER) || defined(CONFIG_APP_ACQ_BLOCK)
+
+/** Buffers handed out by adc_acq_wait() */
+#define ACQ_NUM_BUFFERS CONFIG_APP_ACQ_BUFFERS
+/** Index of the spare buffer, converted into when all the others are in use.
+ * Its blocks are dropped. */
+#define ACQ_SPARE ACQ_NUM_BUFFERS
+
+/** Block buffers, plus the spare */
+static uint16_t acq_buffer[ACQ_NUM_BUFFERS + 1][ACQ_BUFFER_LEN];
+/** References to each buffer, 0 when free. The acquisition holds one while
+ * it converts into the buffer and hands it to the caller of adc_acq_wait(). */
+static atomic_t acq_refs[ACQ_NUM_BUFFERS];
+/** Blocks dropped because no buffer was free or thread A did not pick them up in time */
+static uint32_t acq_overruns;
+
+/** Claims a free buffer for the next block, ACQ_SPARE if none. Interrupt safe. */
+static uint8_t acq_buffer_claim(void)
+{
+    for (uint8_t i = 0; i < ACQ_NUM_BUFFERS; i++) {
+        if (atomic_cas(&acq_refs[i], 0, 1)) {
+            return i;
+        }
+    }
+    return ACQ_SPARE;
+}
+
+/** Drops one reference to buffer idx */
+static void acq_buffer_put(uint8_t idx)
+{
+    if (idx != ACQ_SPARE) {
+        atomic_dec(&acq_refs[idx]);
+    }
+}
+
+/** Buffer that holds samples */
+static uint8_t acq_buffer_index(const uint16_t *samples)
+{
+    return (uint8_t)((samples - acq_buffer[0]) / ACQ_BUFFER_LEN);
+}
+
+void adc_acq_release(const struct adc_acq_block *blk)
+{
+    acq_buffer_put(acq_buffer_index(blk->samples));
+}
+
+/** Prints and clears the number of dropped blocks */
+static void acq_overrun_report(void)
+{
+    if (acq_overruns) {
+        printk("adc_acq_wait(): %u block(s) lost\n", acq_overruns);
+        acq_overruns = 0;
+    }
+}
+
+#else
+
+/** Single and async samples live in one static buffer */
+void adc_acq_release(const struct adc_acq_block *blk) { }
+
+#endif
+
+#if defined(CONFIG_APP_ACQ_HW_TIMED) || defined(CONFIG_APP_ACQ_TIMER)
+
+#include <nrfx_saadc.h>
+
+#if defined(CONFIG_APP_ACQ_HW_TIMED)
+#include <nrfx_timer.h>
+#include <nrfx_ppi.h>
+
+/** TIMER instance that paces the SAADC */
+static const nrfx_timer_t acq_timer = NRFX_TIMER_INSTANCE(2);
+#endif
+
+/** Set once the SAADC has been started */
+static bool acq_running;
+/** Set once the first buffer is latched and SAMPLE tasks are accepted */
+static volatile bool acq_ready;
+/** Completed blocks, posted from the SAADC interrupt */
+K_MSGQ_DEFINE(acq_done_q, sizeof(uint16_t *), ACQ_NUM_BUFFERS, 4);
+/** Cycle stamp of the end of the block in each buffer */
+static uint32_t acq_done_time[ACQ_NUM_BUFFERS];
+
+/** SAADC event handler (interrupt context) */
+static void saadc_handler(nrfx_saadc_evt_t const *p_event)
+{
+    uint16_t *buffer;
+
+    switch (p_event->type) {
+    case NRFX_SAADC_EVT_READY:
+        /* First buffer latched: SAMPLE tasks can be issued from now on */
+        acq_ready = true;
+#if defined(CONFIG_APP_ACQ_HW_TIMED)
+        nrfx_timer_enable(&acq_timer);
+#endif
+        break;
+    case NRFX_SAADC_EVT_BUF_REQ:
+        /* Requested while the previous buffer is converted, so a block
+         * handed out has at least one block period before it is needed again */
+        nrfx_saadc_buffer_set((nrf_saadc_value_t *)acq_buffer[acq_buffer_claim()], ACQ_BUFFER_LEN);
+        break;
+    case NRFX_SAADC_EVT_DONE:
+        buffer = (uint16_t *)p_event->data.done.p_buffer;
+        if (buffer == acq_buffer[ACQ_SPARE]) {
+            acq_overruns++;
+            break;
+        }
+        acq_done_time[acq_buffer_index(buffer)] = k_cycle_get_32();
+        if (k_msgq_put(&acq_done_q, &buffer, K_NO_WAIT)) {
+            acq_buffer_put(acq_buffer_index(buffer));
+            acq_overruns++;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+#if defined(CONFIG_APP_ACQ_HW_TIMED)
+
+/** TIMER event handler. Compare interrupts are not enabled, the nrfx driver just requires one. */
+static void timer_handler(nrf_timer_event_t event_type, void *p_context)
+{
+}
+
+/** Routes TIMER2 COMPARE0 to the SAADC SAMPLE task at CONFIG_APP_ACQ_RATE_HZ */
+static int acq_timer_init(void)
+{
+    nrfx_err_t err;
+    nrf_ppi_channel_t ppi_channel;
+    nrfx_timer_config_t timer_cfg = NRFX_TIMER_DEFAULT_CONFIG;
+
+    timer_cfg.frequency = NRF_TIMER_FREQ_1MHz;
+    timer_cfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
+    err = nrfx_timer_init(&acq_timer, &timer_cfg, timer_handler);
+    if (err != NRFX_SUCCESS) {
+        printk("nrfx_timer_init() failed with error code %d\n", err);
+        return -EIO;
+    }
+    nrfx_timer_extended_compare(&acq_timer, NRF_TIMER_CC_CHANNEL0,
+                                nrfx_timer_us_to_ticks(&acq_timer, 1000000 / CONFIG_APP_ACQ_RATE_HZ),
+                                NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK, false);
+
+    /* TIMER2 COMPARE0 -> SAADC SAMPLE (one scan of all channels), no CPU involved */
+    err = nrfx_ppi_channel_alloc(&ppi_channel);
+    if (err != NRFX_SUCCESS) {
+        printk("nrfx_ppi_channel_alloc() failed with error code %d\n", err);
+        return -EIO;
+    }
+    nrfx_ppi_channel_assign(ppi_channel,
+                            nrfx_timer_compare_event_address_get(&acq_timer, NRF_TIMER_CC_CHANNEL0),
+                            nrf_saadc_task_address_get(NRF_SAADC, NRF_SAADC_TASK_SAMPLE));
+    nrfx_ppi_channel_enable(ppi_channel);
+    return 0;
+}
+
+#else
+
+/** Samples are triggered by software through adc_acq_trigger() */
+static inline int acq_timer_init(void) { return 0; }
+
+void adc_acq_trigger(void)
+{
+    if (acq_ready) {
+        nrf_saadc_task_trigger(NRF_SAADC, NRF_SAADC_TASK_SAMPLE);
+    }
+}
+
+#endif /* CONFIG_APP_ACQ_HW_TIMED */
+
+int adc_acq_init(void)
+{
+    nrfx_err_t err;
+    nrfx_saadc_adv_config_t adv_cfg = NRFX_SAADC_DEFAULT_ADV_CONFIG;
+    nrfx_saadc_channel_t channels[ADC_ACQ_NUM_CHANNELS];
+    uint8_t n = 0;
+
+    IRQ_CONNECT(DT_IRQN(ADC_NID), DT_IRQ(ADC_NID, priority),
+                nrfx_isr, nrfx_saadc_irq_handler, 0);
+
+    err = nrfx_saadc_init(DT_IRQ(ADC_NID, priority));
+    if (err != NRFX_SUCCESS) {
+        printk("nrfx_saadc_init() failed with error code %d\n", err);
+        return -EIO;
+    }
+
+    /* Same analog front-end as the Zephyr driver configuration */
+    for (uint8_t id = 0; id < ADC_ACQ_MAX_CHANNELS; id++) {
+        if (!(ADC_ACQ_CHANNEL_MASK & BIT(id))) {
+            continue;
+        }
+        channels[n] = (nrfx_saadc_channel_t)NRFX_SAADC_DEFAULT_CHANNEL_SE(acq_channel_input[id], id);
+        channels[n].channel_config.gain = NRF_SAADC_GAIN1_4;
+        channels[n].channel_config.reference = NRF_SAADC_REFERENCE_VDD4;
+        channels[n].channel_config.acq_time =
+            UTIL_CAT(UTIL_CAT(NRF_SAADC_ACQTIME_, CONFIG_APP_ACQ_ACQUISITION_TIME_US), US);
+        n++;
+    }
+    err = nrfx_saadc_channels_config(channels, n);
+    if (err != NRFX_SUCCESS) {
+        printk("nrfx_saadc_channels_config() failed with error code %d\n", err);
+        return -EIO;
+    }
+
+    /* Offset calibration (blocking), while the SAADC is still idle. Once the
+     * free-running acquisition is started it is not repeated. */
+    err = nrfx_saadc_offset_calibrate(NULL);
+    if (err != NRFX_SUCCESS) {
+        printk("nrfx_saadc_offset_calibrate() failed with error code %d\n", err);
+        return -EIO;
+    }
+
+    /* External trigger (internal_timer_cc = 0), restart on END for seamless ping-pong.
+     * With oversampling, burst makes one SAMPLE task produce a full averaged scan. */
+    adv_cfg.oversampling = (nrf_saadc_oversample_t)ADC_OVERSAMPLING;
+    adv_cfg.burst = ADC_OVERSAMPLING ? NRF_SAADC_BURST_ENABLED : NRF_SAADC_BURST_DISABLED;
+    adv_cfg.internal_timer_cc = 0;
+    adv_cfg.start_on_end = true;
+    err = nrfx_saadc_advanced_mode_set(ADC_ACQ_CHANNEL_MASK, NRF_SAADC_RESOLUTION_10BIT,
+                                       &adv_cfg, saadc_handler);
+    if (err != NRFX_SUCCESS) {
+        printk("nrfx_saadc_advanced_mode_set() failed with error code %d\n", err);
+        return -EIO;
+    }
+
+    err = acq_timer_init();
+    if (err) {
+        return err;
+    }
+
+    acq_stats_init();
+    return 0;
+}
+
+int adc_acq_start(void)
+{
+    nrfx_err_t err;
+    uint8_t idx;
+
+    if (acq_running) {
+        return 0;
+    }
+
+    idx = acq_buffer_claim();
+    err = nrfx_saadc_buffer_set((nrf_saadc_value_t *)acq_buffer[idx], ACQ_BUFFER_LEN);
+    if (err == NRFX_SUCCESS) {
+        err = nrfx_saadc_mode_trigger();
+    }
+    if (err != NRFX_SUCCESS) {
+        acq_buffer_put(idx);
+        printk("adc_acq_start(): SAADC start failed with error code %d\n", err);
+        return -EIO;
+    }
+
+    acq_running = true;
+#if defined(CONFIG_APP_ACQ_HW_TIMED)
+    printk("HW-timed acquisition: %d Hz, %d ch x %d scans/block\n",
+           CONFIG_APP_ACQ_RATE_HZ, ADC_ACQ_NUM_CHANNELS, ADC_ACQ_BLOCK_SIZE);
+#else
+    printk("Timer-triggered acquisition: %d ch x %d scans/block\n",
+           ADC_ACQ_NUM_CHANNELS, ADC_ACQ_BLOCK_SIZE);
+#endif
+    return 0;
+}
+
+int adc_acq_wait(struct adc_acq_block *blk)
+{
+    timing_t enter = acq_stats_now();
+    uint16_t *buffer;
+    int ret;
+
+    ret = k_msgq_get(&acq_done_q, &buffer, K_FOREVER);
+    if (ret) {
+        return ret;
+    }
+    acq_overrun_report();
+
+    blk->samples = buffer;
+    blk->count = ADC_ACQ_BLOCK_SIZE;
+    blk->channels = ADC_ACQ_NUM_CHANNELS;
+    blk->time = acq_done_time[acq_buffer_index(buffer)];
+    acq_stats_block(enter, blk->count);
+    blk->invalid = acq_correct_block(blk->samples, blk->count);
+    return 0;
+}
+
+#else /* Zephyr ADC driver modes */
+
+/* The nRF SAADC driver refuses oversampling (-EINVAL) with more than one
+ * channel in the sequence: it does not use burst mode */
+BUILD_ASSERT(ADC_ACQ_NUM_CHANNELS == 1 || ADC_OVERSAMPLING == 0,
+             "APP_ACQ_OVERSAMPLING needs a single channel in APP_ACQ_CHANNEL_MASK "
+             "in single, async and block modes");
+
+/** ADC channel configuration (channel_id and input are filled in from the channel table) */
+static struct adc_channel_cfg my_channel_cfg = {
+	.gain = ADC_GAIN,
+	.reference = ADC_REFERENCE,
+	.acquisition_time = ADC_ACQUISITION_TIME,
+};
+
+static const struct device *adc_dev = NULL;
+
+/** Uptime of the next offset calibration (ms) */
+static int64_t acq_calibration_time;
+/** Set once the startup calibration has been requested */
+static bool acq_calibrated;
+
+/** True if the next read must calibrate the SAADC offset first */
+static bool acq_calibrate_due(void)
+{
+    int64_t now = k_uptime_get();
+
+    if (acq_calibrated &&
+        (CONFIG_APP_ACQ_CALIBRATION_PERIOD_MS == 0 || now < acq_calibration_time)) {
+        return false;
+    }
+    acq_calibrated = true;
+    acq_calibration_time = now + CONFIG_APP_ACQ_CALIBRATION_PERIOD_MS;
+    return true;
+}
+
+int adc_acq_init(void)
+{
+    int err = 0;
+
+    adc_dev = device_get_binding(DT_LABEL(ADC_NID));
+    if (!adc_dev) {
+        printk("ADC device_get_binding() failed\n");
+        return -ENODEV;
+    }
+    for (uint8_t id = 0; id < ADC_ACQ_MAX_CHANNELS; id++) {
+        if (!(ADC_ACQ_CHANNEL_MASK & BIT(id))) {
+            continue;
+        }
+        my_channel_cfg.channel_id = id;
+        my_channel_cfg.input_positive = acq_channel_input[id];
+        err = adc_channel_setup(adc_dev, &my_channel_cfg);
+        if (err) {
+            printk("adc_channel_setup() failed with error code %d\n", err);
+            return err;
+        }
+    }
+
+    acq_stats_init();
+    return err;
+}
+
+#if defined(CONFIG_APP_ACQ_BLOCK) || defined(CONFIG_APP_ACQ_ASYNC)
+
+/** Raised by the driver when an adc_read_async() completes */
+static struct k_poll_signal acq_signal;
+static struct k_poll_event acq_event = K_POLL_EVENT_STATIC_INITIALIZER(
+    K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &acq_signal, 0);
+
+/** Waits for the pending adc_read_async() and returns its result */
+static int acq_poll_done(void)
+{
+    unsigned int signaled;
+    int result;
+    int ret;
+
+    acq_event.state = K_POLL_STATE_NOT_READY;
+    ret = k_poll(&acq_event, 1, K_FOREVER);
+    if (ret) {
+        return ret;
+    }
+    k_poll_signal_check(&acq_signal, &signaled, &result);
+    return result;
+}
+
+#endif
+
+#if defined(CONFIG_APP_ACQ_BLOCK)
+
+/** Buffer the driver is currently converting into */
+static uint8_t acq_active;
+/** Set once the first block has been requested */
+static bool acq_running;
+/** Scans converted by the driver in the block being filled */
+static volatile uint16_t acq_filled;
+/** Cycle stamp of the last scan converted */
+static volatile uint32_t acq_filled_time;
+
+/** Driver callback, called after each scan of the block (interrupt context).
+ * ADC_ACTION_CONTINUE lets the driver move on to the next slot of the block. */
+static enum adc_action acq_sampling_done(const struct device *dev,
+                                         const struct adc_sequence *sequence,
+                                         uint16_t sampling_index)
+{
+    acq_filled_time = k_cycle_get_32();
+    acq_filled = sampling_index + 1;
+    return ADC_ACTION_CONTINUE;
+}
+
+/** One block: the first scan plus extra_samplings, interval_us apart */
+static const struct adc_sequence_options acq_options = {
+    .interval_us = 1000000 / CONFIG_APP_ACQ_RATE_HZ,
+    .callback = acq_sampling_done,
+    .extra_samplings = ADC_ACQ_BLOCK_SIZE - 1,
+};
+
+static struct adc_sequence acq_sequence = {
+    .options = &acq_options,
+    .channels = ADC_ACQ_CHANNEL_MASK,
+    .buffer_size = sizeof(acq_buffer[0]),
+    .resolution = ADC_RESOLUTION,
+    .oversampling = ADC_OVERSAMPLING,
+};
+
+/** Calibrates the SAADC offset with a one-scan read. The calibrate flag of
+ * the block sequence would apply to every scan of the block. */
+static int acq_calibrate(void)
+{
+    static uint16_t scan[ADC_ACQ_NUM_CHANNELS];
+    const struct adc_sequence sequence = {
+        .channels = ADC_ACQ_CHANNEL_MASK,
+        .buffer = scan,
+        .buffer_size = sizeof(scan),
+        .resolution = ADC_RESOLUTION,
+        .oversampling = ADC_OVERSAMPLING,
+        .calibrate = true,
+    };
+    int ret;
+
+    ret = adc_read(adc_dev, &sequence);
+    if (ret) {
+        printk("adc_read() calibration failed with code %d\n", ret);
+    }
+    return ret;
+}
+
+/** Starts converting a block into acq_buffer[idx], which the caller claimed */
+static int acq_read_block(uint8_t idx)
+{
+    int ret;
+
+    if (acq_calibrate_due()) {
+        acq_calibrate();
+    }
+    acq_active = idx;
+    acq_filled = 0;
+    acq_sequence.buffer = acq_buffer[idx];
+    k_poll_signal_reset(&acq_signal);
+    ret = adc_read_async(adc_dev, &acq_sequence, &acq_signal);
+    if (ret) {
+        acq_buffer_put(idx);
+        printk("adc_read_async() failed with code %d\n", ret);
+    }
+    return ret;
+}
+
+int adc_acq_start(void)
+{
+    int ret;
+
+    if (acq_running) {
+        return 0;
+    }
+    if (adc_dev == NULL) {
+        printk("adc_acq_start(): error, must bind to adc first \n\r");
+        return -1;
+    }
+
+    ret = acq_read_block(acq_buffer_claim());
+    if (!ret) {
+        acq_running = true;
+        printk("Block acquisition: %d Hz, %d ch x %d scans/block\n",
+               CONFIG_APP_ACQ_RATE_HZ, ADC_ACQ_NUM_CHANNELS, ADC_ACQ_BLOCK_SIZE);
+    }
+    return ret;
+}
+
+int adc_acq_wait(struct adc_acq_block *blk)
+{
+    timing_t enter = acq_stats_now();
+    uint8_t filled;
+    uint16_t count;
+    uint32_t time;
+    int result;
+    int ret;
+
+    do {
+        result = acq_poll_done();
+        count = acq_filled;
+        time = acq_filled_time;
+
+        /* Restart on a free buffer before block N is handed downstream */
+        filled = acq_active;
+        ret = acq_read_block(acq_buffer_claim());
+        if (ret) {
+            acq_running = false;
+        }
+        if (result) {
+            acq_buffer_put(filled);
+            printk("adc_acq_wait(): block failed with code %d\n", result);
+            return result;
+        }
+        /* Every buffer was in use, the block went to the spare one */
+        if (filled == ACQ_SPARE) {
+            acq_overruns++;
+        }
+    } while (filled == ACQ_SPARE && !ret);
+    acq_overrun_report();
+    if (filled == ACQ_SPARE) {
+        return ret;
+    }
+
+    blk->samples = acq_buffer[filled];
+    blk->count = count;
+    blk->channels = ADC_ACQ_NUM_CHANNELS;
+    blk->time = time;
+    acq_stats_block(enter, blk->count);
+    blk->invalid = acq_correct_block(blk->samples, blk->count);
+    return 0;
+}
+
+#elif defined(CONFIG_APP_ACQ_ASYNC)
+
+/** Conversions alternate between two buffers, so the samples of the last
+ * adc_acq_wait() stay valid while the next conversion runs */
+static uint16_t adc_sample_buffer[2][ACQ_BUFFER_LEN];
+/** Buffer of the conversion in progress */
+static uint8_t acq_active;
+/** Cycle stamp of the last conversion completed */
+static volatile uint32_t acq_converted_time;
+
+/** Driver callback, called when the conversion completes (interrupt context) */
+static enum adc_action acq_conversion_done(const struct device *dev,
+                                           const struct adc_sequence *sequence,
+                                           uint16_t sampling_index)
+{
+    acq_converted_time = k_cycle_get_32();
+    return ADC_ACTION_CONTINUE;
+}
+
+/** Stamps the conversion when it completes, not when thread A collects it */
+static const struct adc_sequence_options acq_options = {
+    .callback = acq_conversion_done,
+};
+
+/** One conversion, returned through acq_signal */
+static struct adc_sequence acq_sequence = {
+    .options = &acq_options,
+    .channels = ADC_ACQ_CHANNEL_MASK,
+    .buffer_size = sizeof(adc_sample_buffer[0]),
+    .resolution = ADC_RESOLUTION,
+    .oversampling = ADC_OVERSAMPLING,
+};
+
+int adc_acq_start(void)
+{
+    int ret;
+
+    if (adc_dev == NULL) {
+        printk("adc_acq_start(): error, must bind to adc first \n\r");
+        return -1;
+    }
+
+    acq_active ^= 1;
+    acq_sequence.buffer = adc_sample_buffer[acq_active];
+    acq_sequence.calibrate = acq_calibrate_due();
+    k_poll_signal_reset(&acq_signal);
+    ret = adc_read_async(adc_dev, &acq_sequence, &acq_signal);
+    if (ret) {
+        printk("adc_read_async() failed with code %d\n", ret);
+    }
+    return ret;
+}
+
+int adc_acq_wait(struct adc_acq_block *blk)
+{
+    timing_t enter = acq_stats_now();
+    int ret;
+
+    ret = acq_poll_done();
+    if (ret) {
+        printk("adc_acq_wait(): conversion failed with code %d\n", ret);
+        return ret;
+    }
+
+    blk->samples = adc_sample_buffer[acq_active];
+    blk->count = ADC_ACQ_BLOCK_SIZE;
+    blk->channels = ADC_ACQ_NUM_CHANNELS;
+    blk->time = acq_converted_time;
+    acq_stats_block(enter, blk->count);
+    blk->invalid = acq_correct_block(blk->samples, blk->count);
+    return 0;
+}
+
+#else /* CONFIG_APP_ACQ_SINGLE */
+
+static uint16_t adc_sample_buffer[ACQ_BUFFER_LEN];
+
+/** Takes one sample */
+static int adc_sample(void)
+{
+	int ret;
+	const struct adc_sequence sequence = {
+		.channels = ADC_ACQ_CHANNEL_MASK,
+		.buffer = adc_sample_buffer,
+		.buffer_size = sizeof(adc_sample_buffer),
+		.resolution = ADC_RESOLUTION,
+		.oversampling = ADC_OVERSAMPLING,
+		.calibrate = acq_calibrate_due(),
+	};
+
+	if (adc_dev == NULL) {
+            printk("adc_sample(): error, must bind to adc first \n\r");
+            return -1;
+	}
+
+	ret = adc_read(adc_dev, &sequence);
+	if (ret) {
+            printk("adc_read() failed with code %d\n", ret);
+	}
+
+	return ret;
+}
+
+/** Entry of the last adc_acq_start(): adc_read() blocks thread A there */
+static timing_t acq_read_enter;
+
+int adc_acq_start(void)
+{
+    acq_read_enter = acq_stats_now();
+    return adc_sample();
+}
+
+int adc_acq_wait(struct adc_acq_block *blk)
+{
+    blk->samples = adc_sample_buffer;
+    blk->count = ADC_ACQ_BLOCK_SIZE;
+    blk->channels = ADC_ACQ_NUM_CHANNELS;
+    blk->time = k_cycle_get_32();
+    acq_stats_block(acq_read_enter, blk->count);
+    blk->invalid = acq_correct_block(blk->samples, blk->count);
+    return 0;
+}
+
+#endif /* CONFIG_APP_ACQ_BLOCK */
+
+#endif /* CONFIG_APP_ACQ_HW_TIMED || CONFIG_APP_ACQ_TIMER */
@@ -0,0 +1,129 @@
+/** @file adc_acq.h
+ * @brief ADC acquisition layer shared by the fifo and ShareMem pipelines.
+ *
+ * Thread A asks this layer for samples and gets them back in blocks of
+ * consecutive scans of every enabled channel. Depending on the acquisition mode selected in
+ * Kconfig, a block is either one software-triggered conversion or a
+ * buffer of conversions paced by the driver or by a hardware timer.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#ifndef ADC_ACQ_H
+#define ADC_ACQ_H
+
+#include <zephyr.h>
+
+/** Number of scans delivered per block */
+#if defined(CONFIG_APP_ACQ_HW_TIMED) || defined(CONFIG_APP_ACQ_BLOCK) || defined(CONFIG_APP_ACQ_TIMER)
+#define ADC_ACQ_BLOCK_SIZE CONFIG_APP_ACQ_BLOCK_SIZE
+#else
+#define ADC_ACQ_BLOCK_SIZE 1
+#endif
+
+/** Thread A forwards one scan out of every ADC_ACQ_DECIMATION to the pipeline */
+#if defined(CONFIG_APP_ACQ_HW_TIMED)
+#define ADC_ACQ_DECIMATION CONFIG_APP_ACQ_DECIMATION
+#else
+#define ADC_ACQ_DECIMATION 1
+#endif
+
+/** Number of SAADC channels (and AINx inputs) */
+#define ADC_ACQ_MAX_CHANNELS 8
+
+/** Channels scanned by every acquisition: bit n enables SAADC channel n on input AINn */
+#define ADC_ACQ_CHANNEL_MASK CONFIG_APP_ACQ_CHANNEL_MASK
+
+/** Number of enabled channels below channel id */
+#define ADC_ACQ_CHANNEL_INDEX(id) ((int)( \
+    ((ADC_ACQ_CHANNEL_MASK & (BIT(id) - 1)) >> 0 & 1) + ((ADC_ACQ_CHANNEL_MASK & (BIT(id) - 1)) >> 1 & 1) + \
+    ((ADC_ACQ_CHANNEL_MASK & (BIT(id) - 1)) >> 2 & 1) + ((ADC_ACQ_CHANNEL_MASK & (BIT(id) - 1)) >> 3 & 1) + \
+    ((ADC_ACQ_CHANNEL_MASK & (BIT(id) - 1)) >> 4 & 1) + ((ADC_ACQ_CHANNEL_MASK & (BIT(id) - 1)) >> 5 & 1) + \
+    ((ADC_ACQ_CHANNEL_MASK & (BIT(id) - 1)) >> 6 & 1)))
+
+/** Number of channels interleaved in each scan */
+#define ADC_ACQ_NUM_CHANNELS (ADC_ACQ_CHANNEL_INDEX(7) + (int)((ADC_ACQ_CHANNEL_MASK >> 7) & 1))
+
+/** Position of the channel that drives LED1 within a scan */
+#define ADC_ACQ_LED_CHANNEL ADC_ACQ_CHANNEL_INDEX(CONFIG_APP_ACQ_LED_CHANNEL_ID)
+
+/** Set when the acquisition itself paces thread A (no software release timing) */
+#define ADC_ACQ_SELF_PACED (IS_ENABLED(CONFIG_APP_ACQ_HW_TIMED) || IS_ENABLED(CONFIG_APP_ACQ_BLOCK) || \
+                            IS_ENABLED(CONFIG_APP_ACQ_TIMER))
+
+/** Largest valid reading for the configured resolution */
+#define ADC_ACQ_MAX_VALUE 1023
+
+/** Value of a sample that was out of range. Invalid samples keep their slot
+ * in the block, so stages can skip them with ADC_ACQ_VALID() as a 0/1 weight
+ * instead of a branch per sample. */
+#define ADC_ACQ_INVALID 0x8000
+
+/** 1 if sample v is valid, 0 if it is flagged ADC_ACQ_INVALID */
+#define ADC_ACQ_VALID(v) ((int)(((v) & ADC_ACQ_INVALID) == 0))
+
+/** Unity gain of the per-channel correction (Q14) */
+#define ADC_ACQ_GAIN_ONE (1 << 14)
+
+/** Block of consecutive scans handed out by the acquisition layer.
+ * Samples are interleaved: scan k of channel index c is samples[k * channels + c]. */
+struct adc_acq_block {
+    uint16_t *samples;      /* First sample of the block */
+    uint16_t count;         /* Number of scans in the block */
+    uint8_t channels;       /* Number of channels per scan */
+    uint16_t invalid;       /* Samples flagged ADC_ACQ_INVALID */
+    uint32_t time;          /* k_cycle_get_32() when its last scan was converted */
+};
+
+/** Sample of channel index ch in scan k of blk */
+#define ADC_ACQ_SAMPLE(blk, k, ch) ((blk)->samples[(k) * (blk)->channels + (ch)])
+
+/** Binds and configures the ADC. Must be called once before any other call. */
+int adc_acq_init(void);
+
+/** Sets the correction of SAADC channel id (default: offset 0, unity gain).
+ * Corrected value = (raw - offset) * gain / ADC_ACQ_GAIN_ONE, applied to
+ * every sample before it leaves adc_acq_wait(). */
+int adc_acq_set_correction(uint8_t id, int16_t offset, uint16_t gain);
+
+/** Starts an acquisition.
+ * In single mode it performs the conversion. In async mode it only starts
+ * it, so the caller can do other work before adc_acq_wait(). In block and
+ * hardware-timed modes the first call starts the free-running acquisition
+ * and later calls do nothing. */
+int adc_acq_start(void);
+
+/** Triggers one scan of all enabled channels (timer mode only).
+ * Safe to call from interrupt context, e.g. a k_timer expiry function.
+ * Triggers issued before the acquisition is started are ignored. */
+void adc_acq_trigger(void);
+
+/** Waits for the next block of samples.
+ * Samples are offset/gain corrected; out-of-range readings are set to
+ * ADC_ACQ_INVALID and counted in blk->invalid.
+ * In block, hardware-timed and timer modes the caller owns the buffer the
+ * samples were written to (no copy is made) and must give it back with
+ * adc_acq_release(). While every buffer is in use the acquisition keeps
+ * running and its blocks are dropped. In single mode the samples stay valid
+ * until the next adc_acq_start(), in async mode until the one after, so
+ * they can be handed on while the next conversion runs. */
+int adc_acq_wait(struct adc_acq_block *blk);
+
+/** Gives the buffer of blk back to the acquisition. Safe from any thread;
+ * does nothing in single and async modes. */
+void adc_acq_release(const struct adc_acq_block *blk);
+
+#if defined(CONFIG_APP_ACQ_STATS)
+/** Thread A is about to sleep until its next release. The time until
+ * adc_acq_idle_end() is left out of the thread A load. */
+void adc_acq_idle_begin(void);
+
+/** Thread A was released again */
+void adc_acq_idle_end(void);
+#else
+static inline void adc_acq_idle_begin(void) { }
+static inline void adc_acq_idle_end(void) { }
+#endif
+
+#endif /* ADC_ACQ_H */
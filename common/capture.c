@@ -0,0 +1,141 @@
+/** @file capture.c
+ * @brief Triggered burst capture implementation.
+ *
+ * Only the pre-trigger history lives in the ring. On a trigger it is
+ * copied, oldest sample first, to the start of the snapshot, and the
+ * post-trigger samples are then appended straight into the snapshot.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <sys/atomic.h>
+
+#include "adc_acq.h"
+#include "capture.h"
+
+/** Position of the captured channel within a scan */
+#define CAPTURE_CHANNEL ADC_ACQ_CHANNEL_INDEX(CONFIG_APP_CAPTURE_CHANNEL_ID)
+/** Samples kept before the trigger */
+#define CAPTURE_PRE CONFIG_APP_CAPTURE_PRE_SAMPLES
+/** Samples taken from the trigger on */
+#define CAPTURE_POST CONFIG_APP_CAPTURE_POST_SAMPLES
+/** Trigger level (ADC code) */
+#define CAPTURE_LEVEL CONFIG_APP_CAPTURE_LEVEL
+
+/** Size of stack area used by the print thread */
+#define CAPTURE_STACK_SIZE 1024
+/** Print thread priority, below the pipeline threads */
+#define CAPTURE_PRIO 5
+/** Samples per printed line */
+#define CAPTURE_LINE 16
+
+BUILD_ASSERT(ADC_ACQ_CHANNEL_MASK & BIT(CONFIG_APP_CAPTURE_CHANNEL_ID),
+             "The captured channel must be enabled in APP_ACQ_CHANNEL_MASK");
+
+/** Pre-trigger history, written with every sample of the captured channel */
+static int16_t capture_ring[CAPTURE_PRE];
+/** Next slot of capture_ring to be written */
+static uint16_t capture_head;
+/** Valid samples in capture_ring (less than CAPTURE_PRE right after boot) */
+static uint16_t capture_filled;
+/** Previous sample, for edge detection across blocks */
+static int16_t capture_prev = CAPTURE_LEVEL;
+
+/** Frozen capture: history followed by the post-trigger samples */
+static int16_t capture_snapshot[CAPTURE_PRE + CAPTURE_POST];
+/** Samples written to capture_snapshot */
+static uint16_t capture_len;
+/** Samples of capture_snapshot taken before the trigger */
+static uint16_t capture_pre;
+/** Uptime of the block holding the trigger (ms) */
+static int64_t capture_time;
+/** Set while post-trigger samples are being appended */
+static bool capture_post;
+/** Set from the trigger until the snapshot has been printed */
+static atomic_t capture_busy;
+
+/** Given once per complete snapshot */
+K_SEM_DEFINE(capture_ready, 0, 1);
+
+/** Level crossing on the configured edge. Samples are read as signed, so
+ * ADC_ACQ_INVALID is below any level. */
+static inline bool capture_edge(int16_t prev, int16_t cur)
+{
+#if defined(CONFIG_APP_CAPTURE_EDGE_FALLING)
+    return prev > CAPTURE_LEVEL && cur <= CAPTURE_LEVEL;
+#elif defined(CONFIG_APP_CAPTURE_EDGE_BOTH)
+    return (prev < CAPTURE_LEVEL && cur >= CAPTURE_LEVEL) ||
+           (prev > CAPTURE_LEVEL && cur <= CAPTURE_LEVEL);
+#else
+    return prev < CAPTURE_LEVEL && cur >= CAPTURE_LEVEL;
+#endif
+}
+
+/** Copies the ring, oldest sample first, to the start of the snapshot */
+static void capture_freeze(void)
+{
+    uint16_t i = (capture_head + CAPTURE_PRE - capture_filled) % CAPTURE_PRE;
+
+    for (capture_len = 0; capture_len < capture_filled; capture_len++) {
+        capture_snapshot[capture_len] = capture_ring[i];
+        i = (i + 1 < CAPTURE_PRE) ? i + 1 : 0;
+    }
+    capture_pre = capture_len;
+    capture_time = k_uptime_get();
+}
+
+void capture_feed(const struct adc_acq_block *blk)
+{
+    for (uint16_t k = 0; k < blk->count; k++) {
+        int16_t v = (int16_t)ADC_ACQ_SAMPLE(blk, k, CAPTURE_CHANNEL);
+        bool valid = ADC_ACQ_VALID(v);
+
+        /* An invalid sample keeps its slot but is no level: the edge is
+         * looked for between the valid samples around it */
+        if (valid && !capture_post && capture_edge(capture_prev, v) &&
+            atomic_cas(&capture_busy, 0, 1)) {
+            capture_freeze();
+            capture_post = true;
+        }
+        if (capture_post) {
+            capture_snapshot[capture_len++] = v;
+            if (capture_len == capture_pre + CAPTURE_POST) {
+                capture_post = false;
+                k_sem_give(&capture_ready);
+            }
+        }
+
+        capture_ring[capture_head] = v;
+        capture_head = (capture_head + 1 < CAPTURE_PRE) ? capture_head + 1 : 0;
+        if (capture_filled < CAPTURE_PRE) {
+            capture_filled++;
+        }
+        if (valid) {
+            capture_prev = v;
+        }
+    }
+}
+
+/** Prints each snapshot, then re-arms the trigger */
+static void capture_thread(void *argA, void *argB, void *argC)
+{
+    while (1) {
+        k_sem_take(&capture_ready, K_FOREVER);
+
+        printk("\nCapture ch %d @ %d Hz, t=%u ms: %u samples, trigger at %u, level %d\n",
+               CONFIG_APP_CAPTURE_CHANNEL_ID, CONFIG_APP_ACQ_RATE_HZ, (uint32_t)capture_time,
+               capture_len, capture_pre, CAPTURE_LEVEL);
+        for (uint16_t i = 0; i < capture_len; i++) {
+            printk("%d%c", capture_snapshot[i], (i % CAPTURE_LINE == CAPTURE_LINE - 1) ? '\n' : ' ');
+        }
+        printk("\n");
+
+        atomic_clear(&capture_busy);
+    }
+}
+
+K_THREAD_DEFINE(capture_tid, CAPTURE_STACK_SIZE, capture_thread, NULL, NULL, NULL,
+                CAPTURE_PRIO, 0, 0);
@@ -0,0 +1,34 @@
+/** @file capture.h
+ * @brief Triggered burst capture with pre-trigger history.
+ *
+ * Thread A hands every acquisition block to capture_feed(), before any
+ * decimation. One channel is kept in a RAM ring at the full acquisition
+ * rate; when it crosses the trigger level, the ring contents (pre-trigger
+ * history) and the following samples (post-trigger) are frozen into one
+ * snapshot, which a low priority thread prints. New triggers are ignored
+ * until the snapshot has been printed, but the ring keeps filling.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <zephyr.h>
+
+#include "adc_acq.h"
+
+#if defined(CONFIG_APP_CAPTURE)
+
+/** Feeds one acquisition block to the capture ring and trigger.
+ * Must be called from a single thread, with every block. */
+void capture_feed(const struct adc_acq_block *blk);
+
+#else
+
+static inline void capture_feed(const struct adc_acq_block *blk) { }
+
+#endif /* CONFIG_APP_CAPTURE */
+
+#endif /* CAPTURE_H */
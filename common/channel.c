@@ -0,0 +1,347 @@
+/** @file channel.c
+ * @brief Inter-stage channel over the transport selected in Kconfig.
+ *
+ * Each transport keeps the same contract: elements go in one at a time and
+ * come out a batch at a time. Where the kernel object works on whole
+ * messages (message queue, shared memory) the producer assembles a batch in
+ * a buffer of its own first; where it works on elements or bytes (FIFO,
+ * pipe, ring) every element is handed over as soon as it is sent.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <sys/printk.h>
+#include <sys/__assert.h>
+
+#include "channel.h"
+
+/** Updates the high-water mark of ch */
+static inline void channel_used(struct channel *ch, uint32_t used)
+{
+    if(used > ch->used_max) {
+        ch->used_max = used;
+    }
+}
+
+/** Counts n elements at buf as lost and hands them to the drop handler */
+static void channel_dropped(struct channel *ch, const void *buf, uint32_t n)
+{
+    ch->dropped += n;
+    for(uint32_t i = 0; ch->drop && i < n; i++) {
+        ch->drop((const uint8_t *)buf + i * ch->elem_size);
+    }
+}
+
+/** Elements ch can hold */
+static uint32_t channel_capacity(const struct channel *ch)
+{
+#if defined(CONFIG_APP_CHANNEL_RING)
+    return CONFIG_APP_CHANNEL_RING_SIZE / (ch->elem_size / 2);
+#else
+    return (uint32_t)ch->batch * ch->depth;
+#endif
+}
+
+void channel_init(struct channel *ch)
+{
+    ch->pending = 0;
+    ch->waits = 0;
+    ch->enqueued = 0;
+    ch->used_max = 0;
+    ch->dropped = 0;
+    ch->reported = 0;
+#if defined(CONFIG_APP_CHANNEL_FIFO)
+    k_fifo_init(&ch->fifo);
+    ch->head = NULL;
+    ch->tail = NULL;
+#elif defined(CONFIG_APP_CHANNEL_SEM_SHM)
+    /* The semaphore only wakes the consumer up, it never counts batches */
+    triple_buf_init(&ch->tb, ch->mem, (size_t)ch->batch * ch->elem_size);
+    k_sem_init(&ch->sem, 0, 1);
+#elif defined(CONFIG_APP_CHANNEL_MSGQ)
+    k_msgq_init(&ch->msgq, ch->mem, (size_t)ch->batch * ch->elem_size, ch->depth);
+#elif defined(CONFIG_APP_CHANNEL_PIPE)
+    k_pipe_init(&ch->pipe, ch->mem, (size_t)ch->batch * ch->depth * ch->elem_size);
+#if defined(CONFIG_POLL)
+    k_poll_signal_init(&ch->sig);
+#endif
+#elif defined(CONFIG_APP_CHANNEL_RING)
+    spsc_ring_init(&ch->ring, ch->mem, CONFIG_APP_CHANNEL_RING_SIZE, ch->batch * ch->elem_size / 2);
+#endif
+}
+
+int channel_send(struct channel *ch, const void *elem)
+{
+#if defined(CONFIG_APP_CHANNEL_FIFO)
+    void **item;
+    void **old;
+
+    /* An empty pool means the channel is full */
+    while(k_mem_slab_alloc(ch->mem, (void **)&item, K_NO_WAIT) != 0) {
+        if(ch->policy == CHANNEL_OVERFLOW_DROP_NEWEST) {
+            channel_dropped(ch, elem, 1);
+            return -ENOBUFS;
+        }
+        if(ch->policy == CHANNEL_OVERFLOW_DROP_OLDEST) {
+            /* Take the oldest item back from the consumer's side */
+            old = k_fifo_get(&ch->fifo, K_NO_WAIT);
+            if(old) {
+                channel_dropped(ch, old + 1, 1);
+                k_mem_slab_free(ch->mem, (void **)&old);
+                continue;
+            }
+        }
+        /* Block, or the consumer is still copying the oldest item out */
+        k_mem_slab_alloc(ch->mem, (void **)&item, K_FOREVER);
+        break;
+    }
+    channel_used(ch, k_mem_slab_num_used_get(ch->mem));
+    memcpy(item + 1, elem, ch->elem_size);
+    ch->enqueued++;
+#if defined(CONFIG_APP_CHANNEL_FIFO_PUT_LIST)
+    /* Link through the word reserved for the FIFO and publish the whole
+     * batch at once: a single wake-up of the consumer */
+    *item = NULL;
+    if(ch->tail) {
+        *(void **)ch->tail = item;
+    } else {
+        ch->head = item;
+    }
+    ch->tail = item;
+    if(++ch->pending >= ch->batch) {
+        k_fifo_put_list(&ch->fifo, ch->head, ch->tail);
+        ch->head = NULL;
+        ch->tail = NULL;
+        ch->pending = 0;
+    }
+#else
+    k_fifo_put(&ch->fifo, item);
+#endif
+    return 0;
+#elif defined(CONFIG_APP_CHANNEL_SEM_SHM)
+    memcpy((uint8_t *)triple_buf_write_ptr(&ch->tb) + ch->pending * ch->elem_size, elem, ch->elem_size);
+    if(++ch->pending < ch->batch) {
+        return 0;
+    }
+    ch->pending = 0;
+    /* The previous batch is still unread. Without publishing, the next
+     * batch is written over this one in the same slot. */
+    if(ch->policy == CHANNEL_OVERFLOW_DROP_NEWEST && (atomic_get(&ch->tb.shared) & TRIPLE_BUF_FRESH)) {
+        channel_dropped(ch, triple_buf_write_ptr(&ch->tb), ch->batch);
+        return -ENOBUFS;
+    }
+    channel_used(ch, ch->batch);
+    ch->enqueued += ch->batch;
+    if(triple_buf_publish(&ch->tb)) {
+        /* The unread batch came back to the producer's slot */
+        channel_dropped(ch, triple_buf_write_ptr(&ch->tb), ch->batch);
+    }
+    k_sem_give(&ch->sem);
+    return 0;
+#elif defined(CONFIG_APP_CHANNEL_MSGQ)
+    /* The batch is assembled after the queue buffer, then copied in */
+    size_t msg_size = (size_t)ch->batch * ch->elem_size;
+    uint8_t *msg = (uint8_t *)ch->mem + ch->depth * msg_size;
+    uint8_t *discard = msg + msg_size;
+    int err;
+
+    memcpy(msg + ch->pending * ch->elem_size, elem, ch->elem_size);
+    if(++ch->pending < ch->batch) {
+        return 0;
+    }
+    ch->pending = 0;
+    if(ch->policy == CHANNEL_OVERFLOW_BLOCK) {
+        err = k_msgq_put(&ch->msgq, msg, K_FOREVER);
+    } else {
+        while((err = k_msgq_put(&ch->msgq, msg, K_NO_WAIT)) == -ENOMSG) {
+            if(ch->policy == CHANNEL_OVERFLOW_DROP_NEWEST) {
+                channel_dropped(ch, msg, ch->batch);
+                return -ENOBUFS;
+            }
+            /* Make room by discarding the oldest batch */
+            if(k_msgq_get(&ch->msgq, discard, K_NO_WAIT) == 0) {
+                channel_dropped(ch, discard, ch->batch);
+            }
+        }
+    }
+    if(!err) {
+        channel_used(ch, k_msgq_num_used_get(&ch->msgq) * ch->batch);
+        ch->enqueued += ch->batch;
+    }
+    return err;
+#elif defined(CONFIG_APP_CHANNEL_PIPE)
+    uint8_t *discard = (uint8_t *)ch->mem + (size_t)ch->depth * ch->batch * ch->elem_size;
+    size_t written;
+    size_t read;
+    int err;
+
+    /* All or nothing, so the pipe only ever holds whole elements */
+    if(ch->policy == CHANNEL_OVERFLOW_BLOCK) {
+        err = k_pipe_put(&ch->pipe, (void *)elem, ch->elem_size, &written, ch->elem_size, K_FOREVER);
+    } else {
+        while((err = k_pipe_put(&ch->pipe, (void *)elem, ch->elem_size, &written, ch->elem_size, K_NO_WAIT)) != 0) {
+            if(ch->policy == CHANNEL_OVERFLOW_DROP_NEWEST) {
+                channel_dropped(ch, elem, 1);
+                return -ENOBUFS;
+            }
+            /* Make room by discarding the oldest element */
+            if(k_pipe_get(&ch->pipe, discard, ch->elem_size, &read, ch->elem_size, K_NO_WAIT) == 0) {
+                channel_dropped(ch, discard, 1);
+            }
+        }
+    }
+    if(!err) {
+        channel_used(ch, k_pipe_read_avail(&ch->pipe) / ch->elem_size);
+        ch->enqueued++;
+#if defined(CONFIG_POLL)
+        k_poll_signal_raise(&ch->sig, 0);
+#endif
+    }
+    return err;
+#elif defined(CONFIG_APP_CHANNEL_RING)
+    while(spsc_ring_push(&ch->ring, elem, ch->elem_size / 2) == 0) {
+        /* Only the consumer moves the tail, so the oldest elements cannot
+         * be dropped from here */
+        if(ch->policy != CHANNEL_OVERFLOW_BLOCK) {
+            channel_dropped(ch, elem, 1);
+            return -ENOBUFS;
+        }
+        /* No wake-up from the consumer side: poll for room */
+        k_sleep(K_TICKS(1));
+    }
+    channel_used(ch, ch->ring.max_fill / (ch->elem_size / 2));
+    ch->enqueued++;
+    return 0;
+#endif
+}
+
+int channel_recv(struct channel *ch, void *buf, k_timeout_t timeout)
+{
+#if defined(CONFIG_APP_CHANNEL_FIFO)
+    void **item;
+
+    for(int i = 0; i < ch->batch; i++) {
+        /* Each wait on an empty FIFO switches the consumer out and back in */
+        if(k_fifo_is_empty(&ch->fifo)) {
+            ch->waits++;
+        }
+        item = k_fifo_get(&ch->fifo, timeout);
+        if(item == NULL) {
+            return -EAGAIN;
+        }
+        memcpy((uint8_t *)buf + i * ch->elem_size, item + 1, ch->elem_size);
+        k_mem_slab_free(ch->mem, (void **)&item);
+    }
+    return 0;
+#elif defined(CONFIG_APP_CHANNEL_SEM_SHM)
+    const void *src;
+    bool fresh;
+    int err;
+
+    if(k_sem_count_get(&ch->sem) == 0) {
+        ch->waits++;
+    }
+    /* A batch published between the wake-up and the read leaves the
+     * semaphore given for a batch already read: wait again */
+    do {
+        err = k_sem_take(&ch->sem, timeout);
+        if(err) {
+            return err;
+        }
+        /* Consistent snapshot of the last batch; the producer keeps writing another slot */
+        src = triple_buf_read(&ch->tb, &fresh);
+    } while(!fresh);
+    memcpy(buf, src, (size_t)ch->batch * ch->elem_size);
+    return 0;
+#elif defined(CONFIG_APP_CHANNEL_MSGQ)
+    if(k_msgq_num_used_get(&ch->msgq) == 0) {
+        ch->waits++;
+    }
+    return k_msgq_get(&ch->msgq, buf, timeout);
+#elif defined(CONFIG_APP_CHANNEL_PIPE)
+    size_t bytes = (size_t)ch->batch * ch->elem_size;
+    size_t read;
+
+    if(k_pipe_read_avail(&ch->pipe) < bytes) {
+        ch->waits++;
+    }
+    return k_pipe_get(&ch->pipe, buf, bytes, &read, bytes, timeout);
+#elif defined(CONFIG_APP_CHANNEL_RING)
+    int err;
+
+    /* Woken once per batch; takes it in one go */
+    if(spsc_ring_fill(&ch->ring) < ch->ring.watermark) {
+        ch->waits++;
+    }
+    err = spsc_ring_wait(&ch->ring, timeout);
+    if(err) {
+        return err;
+    }
+    spsc_ring_pop(&ch->ring, buf, ch->batch * ch->elem_size / 2);
+    return 0;
+#endif
+}
+
+#if defined(CONFIG_POLL)
+void channel_poll_init(struct channel *ch, struct k_poll_event *ev)
+{
+#if defined(CONFIG_APP_CHANNEL_FIFO)
+    __ASSERT(ch->batch == 1, "FIFO channels are only polled one element at a time");
+    k_poll_event_init(ev, K_POLL_TYPE_FIFO_DATA_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY, &ch->fifo);
+#elif defined(CONFIG_APP_CHANNEL_SEM_SHM)
+    k_poll_event_init(ev, K_POLL_TYPE_SEM_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY, &ch->sem);
+#elif defined(CONFIG_APP_CHANNEL_MSGQ)
+    k_poll_event_init(ev, K_POLL_TYPE_MSGQ_DATA_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY, &ch->msgq);
+#elif defined(CONFIG_APP_CHANNEL_PIPE)
+    k_poll_event_init(ev, K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &ch->sig);
+#elif defined(CONFIG_APP_CHANNEL_RING)
+    k_poll_event_init(ev, K_POLL_TYPE_SEM_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY, &ch->ring.sem);
+#endif
+}
+
+void channel_poll_arm(struct channel *ch, struct k_poll_event *ev)
+{
+    ev->state = K_POLL_STATE_NOT_READY;
+#if defined(CONFIG_APP_CHANNEL_PIPE)
+    /* Elements sent before the reset are still in the pipe */
+    k_poll_signal_reset(&ch->sig);
+    if(k_pipe_read_avail(&ch->pipe) >= (size_t)ch->batch * ch->elem_size) {
+        k_poll_signal_raise(&ch->sig, 0);
+    }
+#elif defined(CONFIG_APP_CHANNEL_RING)
+    /* k_poll() does not take the semaphore: drop the last wake-up. The
+     * producer only gives it to a waiting consumer, and the batch may have
+     * arrived before it saw the flag. */
+    k_sem_reset(&ch->ring.sem);
+    atomic_set(&ch->ring.waiting, 1);
+    if(spsc_ring_fill(&ch->ring) >= ch->ring.watermark && atomic_cas(&ch->ring.waiting, 1, 0)) {
+        k_sem_give(&ch->ring.sem);
+    }
+#endif
+    /* The FIFO, semaphore and message queue are checked by k_poll() itself */
+}
+#endif
+
+void channel_stats_get(const struct channel *ch, struct channel_stats *st)
+{
+    st->enqueued = ch->enqueued;
+    st->dropped = ch->dropped;
+    st->peak = ch->used_max;
+    st->capacity = channel_capacity(ch);
+}
+
+void channel_report(struct channel *ch)
+{
+    struct channel_stats st;
+
+    channel_stats_get(ch, &st);
+    if(st.peak + st.dropped == ch->reported) {
+        return;
+    }
+    ch->reported = st.peak + st.dropped;
+    printk("Channel %s: peak %u of %u elements, %u enqueued, %u dropped\n", ch->name,
+           st.peak, st.capacity, st.enqueued, st.dropped);
+}
@@ -0,0 +1,202 @@
+/** @file channel.h
+ * @brief Transport between two pipeline stages, selected in Kconfig.
+ *
+ * A channel carries fixed-size elements from one producer thread to one
+ * consumer thread. The producer sends elements one at a time and the
+ * consumer receives them a batch at a time (e.g. one filter window), so a
+ * transport that can wake the consumer once per batch does so. Elements
+ * are copied in and out.
+ *
+ * The transport is the same for every channel of the application:
+ * - APP_CHANNEL_FIFO: one k_mem_slab item per element through a k_fifo
+ * - APP_CHANNEL_SEM_SHM: shared memory (triple buffer of one batch) and a
+ *   wake-up semaphore; the latest batch wins
+ * - APP_CHANNEL_MSGQ: k_msgq of whole batches
+ * - APP_CHANNEL_PIPE: k_pipe byte stream
+ * - APP_CHANNEL_RING: lock-free SPSC ring (see spsc_ring.h)
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <zephyr.h>
+#if defined(CONFIG_APP_CHANNEL_SEM_SHM)
+#include "triple_buf.h"
+#elif defined(CONFIG_APP_CHANNEL_RING)
+#include "spsc_ring.h"
+#endif
+
+/** Name of the transport, for messages */
+#if defined(CONFIG_APP_CHANNEL_FIFO)
+#define CHANNEL_TRANSPORT "FIFO"
+#elif defined(CONFIG_APP_CHANNEL_SEM_SHM)
+#define CHANNEL_TRANSPORT "shmem + semaphores"
+#elif defined(CONFIG_APP_CHANNEL_MSGQ)
+#define CHANNEL_TRANSPORT "message queue"
+#elif defined(CONFIG_APP_CHANNEL_PIPE)
+#define CHANNEL_TRANSPORT "pipe"
+#elif defined(CONFIG_APP_CHANNEL_RING)
+#define CHANNEL_TRANSPORT "lock-free ring"
+#endif
+
+/** Batches a channel holds before the producer blocks. Shared memory only
+ * keeps the latest batch and the ring is sized by APP_CHANNEL_RING_SIZE. */
+#if defined(CONFIG_APP_CHANNEL_DEPTH)
+#define CHANNEL_DEPTH CONFIG_APP_CHANNEL_DEPTH
+#else
+#define CHANNEL_DEPTH 1
+#endif
+
+/** What channel_send() does when the channel is full */
+enum channel_overflow {
+    CHANNEL_OVERFLOW_BLOCK,         /* Wait until the consumer makes room */
+    CHANNEL_OVERFLOW_DROP_OLDEST,   /* Discard the oldest queued elements, keep the new one */
+    CHANNEL_OVERFLOW_DROP_NEWEST,   /* Discard the new element */
+};
+
+/** Overflow policy selected in Kconfig */
+#if defined(CONFIG_APP_CHANNEL_OVERFLOW_DROP_OLDEST)
+#define CHANNEL_OVERFLOW_DEFAULT CHANNEL_OVERFLOW_DROP_OLDEST
+#elif defined(CONFIG_APP_CHANNEL_OVERFLOW_DROP_NEWEST)
+#define CHANNEL_OVERFLOW_DEFAULT CHANNEL_OVERFLOW_DROP_NEWEST
+#else
+#define CHANNEL_OVERFLOW_DEFAULT CHANNEL_OVERFLOW_BLOCK
+#endif
+
+/** Channel state. Fields marked (producer)/(consumer) are written by one side only. */
+struct channel {
+    const char *name;
+    uint16_t elem_size;     /* Bytes per element */
+    uint16_t batch;         /* Elements per channel_recv() */
+    uint16_t depth;         /* Batches in flight */
+    uint16_t pending;       /* Elements of the batch being sent (producer) */
+    enum channel_overflow policy;
+    void (*drop)(const void *elem); /* Called for each element lost to overflow (producer) */
+    void *mem;              /* Transport storage (item pool of the FIFO), see CHANNEL_DEFINE() */
+    uint32_t waits;         /* Receives that found no data and blocked (consumer) */
+    uint32_t enqueued;      /* Elements handed to the consumer side (producer) */
+    uint32_t used_max;      /* Peak depth in elements (producer) */
+    uint32_t dropped;       /* Elements lost to overflow (producer) */
+    uint32_t reported;      /* used_max + dropped at the last channel_report() */
+#if defined(CONFIG_APP_CHANNEL_FIFO)
+    struct k_fifo fifo;
+    void *head;             /* Batch linked but not yet published (put_list) */
+    void *tail;
+#elif defined(CONFIG_APP_CHANNEL_SEM_SHM)
+    struct triple_buf tb;
+    struct k_sem sem;
+#elif defined(CONFIG_APP_CHANNEL_MSGQ)
+    struct k_msgq msgq;
+#elif defined(CONFIG_APP_CHANNEL_PIPE)
+    struct k_pipe pipe;
+#if defined(CONFIG_POLL)
+    struct k_poll_signal sig;   /* Raised on every element: k_pipe cannot be polled */
+#endif
+#elif defined(CONFIG_APP_CHANNEL_RING)
+    struct spsc_ring ring;
+#endif
+};
+
+/** Counters of a channel, see channel_stats_get() */
+struct channel_stats {
+    uint32_t enqueued;      /* Elements handed to the consumer side */
+    uint32_t dropped;       /* Elements lost to overflow */
+    uint32_t peak;          /* Largest number of elements in the channel */
+    uint32_t capacity;      /* Elements the channel holds */
+};
+
+/** Pool item of the FIFO transport: the word reserved for the k_fifo, then the element */
+#define CHANNEL_ITEM_SIZE(elem_size) ROUND_UP(sizeof(void *) + (elem_size), 4)
+
+#define CHANNEL_INITIALIZER(_name, _elem_size, _batch, _depth, _mem) \
+    { .name = #_name, .elem_size = (_elem_size), .batch = (_batch), \
+      .depth = (_depth), .mem = (_mem), .policy = CHANNEL_OVERFLOW_DEFAULT }
+
+/** Defines channel _name for elements of _elem_size bytes, received
+ * _batch at a time, with storage for _depth batches. It must still be set
+ * up with channel_init() before use. */
+#if defined(CONFIG_APP_CHANNEL_FIFO)
+#define CHANNEL_DEFINE(_name, _elem_size, _batch, _depth) \
+    K_MEM_SLAB_DEFINE(_name##_slab, CHANNEL_ITEM_SIZE(_elem_size), (_batch) * (_depth), 4); \
+    struct channel _name = CHANNEL_INITIALIZER(_name, _elem_size, _batch, _depth, &_name##_slab)
+#elif defined(CONFIG_APP_CHANNEL_SEM_SHM)
+#define CHANNEL_DEFINE(_name, _elem_size, _batch, _depth) \
+    static uint8_t __aligned(4) _name##_mem[3 * (_batch) * (_elem_size)]; \
+    struct channel _name = CHANNEL_INITIALIZER(_name, _elem_size, _batch, 1, _name##_mem)
+#elif defined(CONFIG_APP_CHANNEL_MSGQ)
+/* Two extra batches: one where the producer assembles the next message,
+ * one where it discards the oldest message */
+#define CHANNEL_DEFINE(_name, _elem_size, _batch, _depth) \
+    static char __aligned(4) _name##_mem[((_depth) + 2) * (_batch) * (_elem_size)]; \
+    struct channel _name = CHANNEL_INITIALIZER(_name, _elem_size, _batch, _depth, _name##_mem)
+#elif defined(CONFIG_APP_CHANNEL_PIPE)
+/* One extra element where the producer discards the oldest element */
+#define CHANNEL_DEFINE(_name, _elem_size, _batch, _depth) \
+    static unsigned char __aligned(4) _name##_mem[((_depth) * (_batch) + 1) * (_elem_size)]; \
+    struct channel _name = CHANNEL_INITIALIZER(_name, _elem_size, _batch, _depth, _name##_mem)
+#elif defined(CONFIG_APP_CHANNEL_RING)
+/* The ring stores 16-bit words and wakes the consumer at one batch */
+#define CHANNEL_DEFINE(_name, _elem_size, _batch, _depth) \
+    BUILD_ASSERT((_elem_size) % 2 == 0, "ring elements must be a whole number of 16-bit words"); \
+    BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_APP_CHANNEL_RING_SIZE) && \
+                 CONFIG_APP_CHANNEL_RING_SIZE >= (_batch) * (_elem_size) / 2, \
+                 "APP_CHANNEL_RING_SIZE must be a power of two holding one batch of " #_name); \
+    static uint16_t _name##_mem[CONFIG_APP_CHANNEL_RING_SIZE]; \
+    struct channel _name = CHANNEL_INITIALIZER(_name, _elem_size, _batch, 1, _name##_mem)
+#endif
+
+/** Sets up the transport of a channel defined with CHANNEL_DEFINE() */
+void channel_init(struct channel *ch);
+
+/** Sets the overflow policy of ch (default CHANNEL_OVERFLOW_DEFAULT).
+ * Shared memory cannot block, it drops the oldest batch instead; the ring
+ * cannot drop its oldest elements (only the consumer moves its tail), it
+ * drops the new one instead. */
+static inline void channel_set_overflow(struct channel *ch, enum channel_overflow policy)
+{
+    ch->policy = policy;
+}
+
+/** Sets a handler that the producer calls for each element lost to
+ * overflow, e.g. to release what the element refers to */
+static inline void channel_set_drop(struct channel *ch, void (*drop)(const void *elem))
+{
+    ch->drop = drop;
+}
+
+/** Producer: sends one element. When the channel is full, the overflow
+ * policy either blocks, discards the oldest elements or refuses this one
+ * (-ENOBUFS); lost elements are counted in the channel statistics. The
+ * transports that hand over whole batches (shared memory, message queue)
+ * apply the policy to the batch when its last element is sent. */
+int channel_send(struct channel *ch, const void *elem);
+
+/** Consumer: receives the next batch of ch->batch elements into buf.
+ * Returns 0, or a negative error code (e.g. -EAGAIN on timeout). With the
+ * FIFO transport, elements already taken when the timeout expires are lost. */
+int channel_recv(struct channel *ch, void *buf, k_timeout_t timeout);
+
+#if defined(CONFIG_POLL)
+/** Consumer: sets up ev, so that k_poll() on it returns when a batch of ch
+ * may be ready. Lets a consumer wait on the channel and on other events in
+ * one call. With the FIFO transport the event fires at the first element,
+ * so ch must have a batch of 1. */
+void channel_poll_init(struct channel *ch, struct k_poll_event *ev);
+
+/** Consumer: rearms ev before each k_poll(). A batch already in the
+ * channel makes k_poll() return at once. Then channel_recv() with K_NO_WAIT
+ * takes the batch; it may still find none (an error), as the event can fire
+ * for a batch already received. */
+void channel_poll_arm(struct channel *ch, struct k_poll_event *ev);
+#endif
+
+/** Reads the counters of ch. Safe from any thread while the channel runs. */
+void channel_stats_get(const struct channel *ch, struct channel_stats *st);
+
+/** Prints the peak depth and lost elements of ch, only when they changed */
+void channel_report(struct channel *ch);
+
+#endif /* CHANNEL_H */
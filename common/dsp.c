@@ -0,0 +1,121 @@
+/** @file dsp.c
+ * @brief q15 signal processing kernels: CMSIS-DSP or portable C.
+ *
+ * The portable kernels follow the CMSIS-DSP reference code step by step:
+ * a wide accumulator, an arithmetic (flooring) shift, a cast to 32 bits
+ * and a saturation to 16 bits, as __SSAT() does.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <sys/__assert.h>
+
+#include "dsp.h"
+
+/** Saturates v to 16 bits, like __SSAT(v, 16) */
+static inline int16_t dsp_sat16(int32_t v)
+{
+    return (int16_t)CLAMP(v, INT16_MIN, INT16_MAX);
+}
+
+int16_t dsp_mean_q15_c(const int16_t *x, uint32_t n)
+{
+    int32_t sum = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        sum += x[i];
+    }
+    return (int16_t)(sum / (int32_t)n);
+}
+
+void dsp_fir_q15_c(struct dsp_fir *f, const int16_t *in, int16_t *out, uint32_t n)
+{
+    /* The last taps - 1 inputs, then the new ones */
+    int16_t *hist = f->state;
+
+    memcpy(&hist[f->taps - 1], in, n * sizeof(*in));
+    for (uint32_t i = 0; i < n; i++) {
+        int64_t acc = 0;
+
+        for (int k = 0; k < f->taps; k++) {
+            acc += (int32_t)f->coef[k] * hist[i + k];
+        }
+        out[i] = dsp_sat16((int32_t)(acc >> 15));
+    }
+    memmove(hist, &hist[n], (f->taps - 1) * sizeof(*hist));
+}
+
+void dsp_biquad_q15_c(struct dsp_biquad *f, const int16_t *in, int16_t *out, uint32_t n)
+{
+    const int16_t *k = f->coef;
+    int16_t *s = f->state;
+
+    for (uint32_t i = 0; i < n; i++) {
+        int64_t acc = (int32_t)k[0] * in[i] + (int32_t)k[2] * s[0] + (int32_t)k[3] * s[1];
+        int16_t y;
+
+        acc += (int64_t)k[4] * s[2] + (int64_t)k[5] * s[3];
+        y = dsp_sat16((int32_t)(acc >> (15 - f->post_shift)));
+        s[1] = s[0];
+        s[0] = in[i];
+        s[3] = s[2];
+        s[2] = y;
+        out[i] = y;
+    }
+}
+
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+
+int16_t dsp_mean_q15(const int16_t *x, uint32_t n)
+{
+    q15_t mean;
+
+    arm_mean_q15(x, n, &mean);
+    return mean;
+}
+
+void dsp_fir_q15(struct dsp_fir *f, const int16_t *in, int16_t *out, uint32_t n)
+{
+    arm_fir_q15(&f->inst, in, out, n);
+}
+
+void dsp_biquad_q15(struct dsp_biquad *f, const int16_t *in, int16_t *out, uint32_t n)
+{
+    arm_biquad_cascade_df1_q15(&f->inst, in, out, n);
+}
+
+#endif /* CONFIG_APP_FILTER_CMSIS_DSP */
+
+void dsp_fir_init(struct dsp_fir *f, const int16_t *taps, uint16_t n)
+{
+    __ASSERT(n <= DSP_FIR_MAX_TAPS, "FIR longer than DSP_FIR_MAX_TAPS");
+
+    /* Zero taps first (the oldest samples), so the filter is unchanged */
+    f->taps = MAX(ROUND_UP(n, 2), 4);
+    memset(f->coef, 0, sizeof(f->coef));
+    for (int k = 0; k < n; k++) {
+        f->coef[f->taps - 1 - k] = taps[k];
+    }
+    memset(f->state, 0, sizeof(f->state));
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+    arm_fir_init_q15(&f->inst, f->taps, f->coef, f->state, DSP_FIR_MAX_BLOCK);
+#endif
+}
+
+void dsp_biquad_init(struct dsp_biquad *f, const int16_t *coef, int8_t post_shift)
+{
+    f->coef[0] = coef[0];
+    f->coef[1] = 0;
+    f->coef[2] = coef[1];
+    f->coef[3] = coef[2];
+    f->coef[4] = -coef[3];
+    f->coef[5] = -coef[4];
+    f->post_shift = post_shift;
+    memset(f->state, 0, sizeof(f->state));
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+    arm_biquad_cascade_df1_init_q15(&f->inst, 1, f->coef, f->state, post_shift);
+#endif
+}
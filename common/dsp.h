@@ -0,0 +1,87 @@
+/** @file dsp.h
+ * @brief q15 signal processing kernels of thread B.
+ *
+ * With APP_FILTER_CMSIS_DSP the kernels are the CMSIS-DSP q15 routines,
+ * which use the Cortex-M4 SIMD instructions (SMLAD, SMLALD, SSAT).
+ * Otherwise they are portable C that does the same arithmetic: the
+ * same accumulator widths, truncating shifts and saturation. Results are
+ * bit-identical, so filters can be checked on native or qemu builds.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#ifndef DSP_H
+#define DSP_H
+
+#include <zephyr.h>
+
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+#include <arm_math.h>
+#endif
+
+/** Name of the kernel implementation, for messages */
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+#define DSP_KERNELS "CMSIS-DSP"
+#else
+#define DSP_KERNELS "portable C"
+#endif
+
+/** Longest FIR (taps) */
+#define DSP_FIR_MAX_TAPS 32
+/** Most samples per dsp_fir_q15() call */
+#define DSP_FIR_MAX_BLOCK 16
+
+/** FIR filter and its history */
+struct dsp_fir {
+    int16_t __aligned(4) coef[DSP_FIR_MAX_TAPS];   /* Taps, oldest sample first (CMSIS order) */
+    int16_t __aligned(4) state[DSP_FIR_MAX_TAPS + DSP_FIR_MAX_BLOCK]; /* arm_fir_q15 reads pairs past taps + block - 1 */
+    uint16_t taps;                                  /* Even and at least 4, as CMSIS requires */
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+    arm_fir_instance_q15 inst;
+#endif
+};
+
+/** One second-order section, direct form I */
+struct dsp_biquad {
+    int16_t __aligned(4) coef[6];   /* b0 0 b1 b2 -a1 -a2, the CMSIS layout */
+    int16_t __aligned(4) state[4];  /* x[n-1] x[n-2] y[n-1] y[n-2] */
+    int8_t post_shift;
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+    arm_biquad_casd_df1_inst_q15 inst;
+#endif
+};
+
+/** Mean of n samples, truncated (arm_mean_q15()) */
+int16_t dsp_mean_q15(const int16_t *x, uint32_t n);
+
+/** Sets up f with n taps (at most DSP_FIR_MAX_TAPS), taps[k] weighing the
+ * input k samples old, in Q15. Odd or short filters are padded with zero
+ * taps. The history starts at 0. */
+void dsp_fir_init(struct dsp_fir *f, const int16_t *taps, uint16_t n);
+
+/** Filters n samples (at most DSP_FIR_MAX_BLOCK) of in into out
+ * (arm_fir_q15(): 64-bit sum, shifted down 15 and saturated) */
+void dsp_fir_q15(struct dsp_fir *f, const int16_t *in, int16_t *out, uint32_t n);
+
+/** Sets up f from b0 b1 b2 a1 a2 (a0 = 1) in Q(15 - post_shift). The
+ * history starts at 0. */
+void dsp_biquad_init(struct dsp_biquad *f, const int16_t *coef, int8_t post_shift);
+
+/** Filters n samples of in into out (arm_biquad_cascade_df1_q15(): 64-bit
+ * sum, shifted down 15 - post_shift and saturated) */
+void dsp_biquad_q15(struct dsp_biquad *f, const int16_t *in, int16_t *out, uint32_t n);
+
+/* The portable kernels. With CMSIS-DSP they are built as well, to check
+ * and time the library against; otherwise they are the kernels above. */
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+int16_t dsp_mean_q15_c(const int16_t *x, uint32_t n);
+void dsp_fir_q15_c(struct dsp_fir *f, const int16_t *in, int16_t *out, uint32_t n);
+void dsp_biquad_q15_c(struct dsp_biquad *f, const int16_t *in, int16_t *out, uint32_t n);
+#else
+#define dsp_mean_q15_c dsp_mean_q15
+#define dsp_fir_q15_c dsp_fir_q15
+#define dsp_biquad_q15_c dsp_biquad_q15
+#endif
+
+#endif /* DSP_H */
@@ -0,0 +1,656 @@
+/** @file filter.c
+ * @brief Fixed-point filter stages of thread B.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <sys/printk.h>
+#include <sys/__assert.h>
+#include <timing/timing.h>
+
+#include "adc_acq.h"
+#include "filter.h"
+#include "dsp.h"
+
+int filter_band_mean(const uint16_t *x, int n, int stride, uint32_t band_pm, int *out)
+{
+    uint32_t sum = 0;
+    uint32_t nvalid = 0;
+    uint32_t kept_sum = 0;
+    uint32_t kept = 0;
+    uint32_t limit;
+
+    /* Values flagged ADC_ACQ_INVALID weigh 0 */
+    for (int i = 0; i < n; i++) {
+        uint32_t valid = ADC_ACQ_VALID(x[i * stride]);
+
+        sum += x[i * stride] * valid;
+        nvalid += valid;
+    }
+    if (nvalid == 0) {
+        return 0;
+    }
+
+    /* |x - sum / nvalid| <= sum / nvalid * band_pm / 1000, scaled by
+     * 1000 * nvalid so the mean is never rounded. 1023 x 1024 x 1000 still
+     * fits in 32 bits. */
+    limit = sum * band_pm;
+    for (int i = 0; i < n; i++) {
+        uint32_t v = x[i * stride];
+        uint32_t dev = v * nvalid > sum ? v * nvalid - sum : sum - v * nvalid;
+        uint32_t in = ADC_ACQ_VALID(v) & (dev * 1000 <= limit);
+
+        kept_sum += v * in;
+        kept += in;
+    }
+    if (kept == 0) {
+        /* Nothing within the band, e.g. a window split between two levels */
+        *out = (int)(sum / nvalid);
+        return -(int)nvalid;
+    }
+    *out = (int)(kept_sum / kept);
+    return (int)kept;
+}
+
+void filter_ma_init(struct filter_ma *f, uint16_t *buf, uint32_t len)
+{
+    __ASSERT(IS_POWER_OF_TWO(len), "moving average length must be a power of two");
+
+    f->buf = buf;
+    f->mask = len - 1;
+    f->shift = (uint8_t)(31 - __builtin_clz(len));
+    f->idx = 0;
+    f->count = 0;
+    f->sum = 0;
+}
+
+int filter_ma_update(struct filter_ma *f, uint16_t v, int *out)
+{
+    if (ADC_ACQ_VALID(v)) {
+        /* Full window: the oldest sample leaves the sum as v enters */
+        if (f->count > f->mask) {
+            f->sum -= f->buf[f->idx];
+        } else {
+            f->count++;
+        }
+        f->sum += v;
+        f->buf[f->idx] = v;
+        f->idx = (f->idx + 1) & f->mask;
+    }
+    if (f->count == 0) {
+        return 0;
+    }
+    /* Only the first len - 1 outputs divide */
+    *out = (int)(f->count > f->mask ? f->sum >> f->shift : f->sum / f->count);
+    return (int)f->count;
+}
+
+void filter_median_init(struct filter_median *f, uint16_t *hist, uint16_t *buf, uint16_t len)
+{
+    __ASSERT(len > 0, "median of no sample");
+
+    memset(hist, 0, FILTER_MEDIAN_BINS * sizeof(*hist));
+    f->hist = hist;
+    f->buf = buf;
+    f->len = len;
+    f->idx = 0;
+    f->count = 0;
+    f->med = 0;
+    f->below = 0;
+}
+
+int filter_median_update(struct filter_median *f, uint16_t v, int *out)
+{
+    uint16_t *hist = f->hist;
+    uint32_t rank;
+
+    if (ADC_ACQ_VALID(v)) {
+        v = MIN(v, ADC_ACQ_MAX_VALUE);
+        /* Full window: the oldest sample leaves the histogram as v enters */
+        if (f->count == f->len) {
+            uint16_t old = f->buf[f->idx];
+
+            hist[old]--;
+            f->below -= old < f->med;
+        } else {
+            f->count++;
+        }
+        hist[v]++;
+        f->below += v < f->med;
+        f->buf[f->idx] = v;
+        f->idx = (f->idx + 1 == f->len) ? 0 : f->idx + 1;
+
+        /* The median is the sample of rank (count + 1) / 2: move med until
+         * below < rank <= below + hist[med]. It moves by at most one
+         * sample, plus the codes in between that no sample holds. */
+        rank = (f->count + 1) / 2;
+        while (f->below >= rank) {
+            f->med--;
+            f->below -= hist[f->med];
+        }
+        while (f->below + hist[f->med] < rank) {
+            f->below += hist[f->med];
+            f->med++;
+        }
+    }
+    if (f->count == 0) {
+        return 0;
+    }
+    *out = f->med;
+    return (int)f->count;
+}
+
+void filter_chain_init(const struct filter_chain *chain)
+{
+    for (int i = 0; i < chain->n; i++) {
+        const struct filter_stage *s = &chain->stages[i];
+
+        __ASSERT(s->type != FILTER_FIR || s->len <= FILTER_FIR_MAX_TAPS, "FIR too long");
+        __ASSERT(s->type != FILTER_MEDIAN || (s->len <= FILTER_MEDIAN_MAX && (s->len & 1)),
+                 "median length must be odd and at most FILTER_MEDIAN_MAX");
+        __ASSERT(s->type != FILTER_MA || s->len <= FILTER_CHAIN_MA_MAX, "moving average too long");
+
+        memset(s->state, 0, ADC_ACQ_NUM_CHANNELS * sizeof(*s->state));
+        for (int c = 0; c < ADC_ACQ_NUM_CHANNELS; c++) {
+            if (s->type == FILTER_MA) {
+                filter_ma_init(&s->state[c].ma.ma, s->state[c].ma.buf, s->len);
+            } else if (s->type == FILTER_FIR) {
+                dsp_fir_init(&s->state[c].fir, s->coef, s->len);
+            } else if (s->type == FILTER_BIQUAD) {
+                /* Q14 coefficients: one bit of post-shift */
+                dsp_biquad_init(&s->state[c].biquad, s->coef, 1);
+            }
+        }
+    }
+}
+
+int filter_ma_step(const struct filter_stage *s, int c, int v)
+{
+    int out = v;
+
+    filter_ma_update(&s->state[c].ma.ma, (uint16_t)v, &out);
+    return out;
+}
+
+int filter_fir_step(const struct filter_stage *s, int c, int v)
+{
+    int16_t x = (int16_t)v;
+    int16_t y;
+
+    /* Truncated, as arm_fir_q15() does */
+    dsp_fir_q15(&s->state[c].fir, &x, &y, 1);
+    return CLAMP(y, 0, ADC_ACQ_MAX_VALUE);
+}
+
+int filter_biquad_step(const struct filter_stage *s, int c, int v)
+{
+    int16_t x = (int16_t)(v << FILTER_IIR_GUARD);
+    int16_t y;
+
+    /* Direct form I on inputs and outputs with FILTER_IIR_GUARD fraction
+     * bits; only the value returned is rounded to an integer */
+    dsp_biquad_q15(&s->state[c].biquad, &x, &y, 1);
+    return CLAMP((y + (1 << (FILTER_IIR_GUARD - 1))) >> FILTER_IIR_GUARD, 0, ADC_ACQ_MAX_VALUE);
+}
+
+void filter_fir_block(const struct filter_stage *s, int c, int16_t *x, int n)
+{
+    int16_t y[FILTER_CHAIN_BLOCK];
+
+    /* arm_fir_q15() is not documented to work in place */
+    dsp_fir_q15(&s->state[c].fir, x, y, n);
+    for (int i = 0; i < n; i++) {
+        x[i] = CLAMP(y[i], 0, ADC_ACQ_MAX_VALUE);
+    }
+}
+
+void filter_biquad_block(const struct filter_stage *s, int c, int16_t *x, int n)
+{
+    for (int i = 0; i < n; i++) {
+        x[i] = (int16_t)(x[i] << FILTER_IIR_GUARD);
+    }
+    dsp_biquad_q15(&s->state[c].biquad, x, x, n);
+    for (int i = 0; i < n; i++) {
+        x[i] = CLAMP((x[i] + (1 << (FILTER_IIR_GUARD - 1))) >> FILTER_IIR_GUARD, 0, ADC_ACQ_MAX_VALUE);
+    }
+}
+
+int filter_chain_run_block(const struct filter_chain *chain, int c, const uint16_t *x, int n,
+                           int stride, int *out)
+{
+    int16_t buf[FILTER_CHAIN_BLOCK];
+    int valid = 0;
+    int i = 0;
+
+    while (i < n) {
+        int m = 0;
+
+        /* The next valid samples, contiguous */
+        for (; i < n && m < FILTER_CHAIN_BLOCK; i++) {
+            uint16_t v = x[i * stride];
+
+            if (ADC_ACQ_VALID(v)) {
+                buf[m++] = (int16_t)v;
+            }
+        }
+        if (m == 0) {
+            break;
+        }
+        for (int k = 0; k < chain->n; k++) {
+            const struct filter_stage *s = &chain->stages[k];
+
+            switch (s->type) {
+            case FILTER_FIR:
+                filter_fir_block(s, c, buf, m);
+                break;
+            case FILTER_BIQUAD:
+                filter_biquad_block(s, c, buf, m);
+                break;
+            case FILTER_MA:
+                for (int j = 0; j < m; j++) {
+                    buf[j] = (int16_t)filter_ma_step(s, c, buf[j]);
+                }
+                break;
+            case FILTER_MEDIAN:
+                for (int j = 0; j < m; j++) {
+                    buf[j] = (int16_t)filter_median_step(s, c, buf[j]);
+                }
+                break;
+            }
+        }
+        valid += m;
+        *out = buf[m - 1];
+    }
+    return valid;
+}
+
+int filter_median_step(const struct filter_stage *s, int c, int v)
+{
+    union filter_state *st = &s->state[c];
+    uint16_t *sorted = st->median.sorted;
+    int n = st->median.count;
+    int i;
+
+    /* Full: the oldest sample leaves the sorted list first */
+    if (n == s->len) {
+        uint16_t old = st->median.ring[st->median.idx];
+
+        for (i = 0; sorted[i] != old; i++) {
+        }
+        for (n--; i < n; i++) {
+            sorted[i] = sorted[i + 1];
+        }
+    }
+    /* Insertion of the new sample, O(len) */
+    for (i = n; i > 0 && sorted[i - 1] > v; i--) {
+        sorted[i] = sorted[i - 1];
+    }
+    sorted[i] = (uint16_t)v;
+    st->median.count = n + 1;
+
+    st->median.ring[st->median.idx] = (uint16_t)v;
+    st->median.idx = (st->median.idx + 1 == s->len) ? 0 : st->median.idx + 1;
+    /* n + 1 samples: the lower median while the window fills */
+    return sorted[n / 2];
+}
+
+#if defined(CONFIG_APP_FILTER_BENCH)
+
+/** Windows filtered per measurement */
+#define FILTER_BENCH_RUNS 100
+/** Window lengths measured */
+static const int filter_bench_len[] = { 16, 128, 1024 };
+/** Largest window length measured */
+#define FILTER_BENCH_MAX 1024
+
+/** The band test thread B used to run: double precision band of +-10 %,
+ * with its || turned into && so both versions keep the same samples */
+static int bench_band_mean_double(const uint16_t *x, int n)
+{
+    int avg = 0;
+    int nvalid = 0;
+    int avgmax, avgmin;
+    int sum = 0;
+    int cnt = 0;
+
+    for (int i = 0; i < n; i++) {
+        avg += x[i] * ADC_ACQ_VALID(x[i]);
+        nvalid += ADC_ACQ_VALID(x[i]);
+    }
+    avg = avg / MAX(nvalid, 1);
+    avgmax = avg + avg * 0.1;
+    avgmin = avg - avg * 0.1;
+    for (int i = 0; i < n; i++) {
+        int in = ADC_ACQ_VALID(x[i]) & (x[i] < avgmax && x[i] > avgmin);
+
+        sum += x[i] * in;
+        cnt += in;
+    }
+    return cnt ? sum / cnt : 0;
+}
+
+static int bench_band_mean(const uint16_t *x, int n)
+{
+    int out = 0;
+
+    filter_band_mean(x, n, 1, 100, &out);
+    return out;
+}
+
+/* The streaming filters are set up with a full window of n samples
+ * before they are timed, so each measured sample is a steady-state update:
+ * one sample leaves the window as another enters */
+static struct filter_ma bench_ma;
+static struct filter_median bench_med;
+/** Next sample of x fed to them. It wraps one sample short of x, so the
+ * sample leaving a window of 16 to 1024 differs from the one entering. */
+static int bench_pos;
+
+static inline uint16_t bench_next(const uint16_t *x)
+{
+    uint16_t v = x[bench_pos];
+
+    bench_pos = (bench_pos + 1 == FILTER_BENCH_MAX - 1) ? 0 : bench_pos + 1;
+    return v;
+}
+
+static void bench_moving_average_setup(const uint16_t *x, int n)
+{
+    static uint16_t buf[FILTER_BENCH_MAX];
+    int out;
+
+    filter_ma_init(&bench_ma, buf, n);
+    bench_pos = 0;
+    for (int i = 0; i < n; i++) {
+        filter_ma_update(&bench_ma, bench_next(x), &out);
+    }
+}
+
+static int bench_moving_average(const uint16_t *x, int n)
+{
+    int out = 0;
+
+    for (int i = 0; i < n; i++) {
+        filter_ma_update(&bench_ma, bench_next(x), &out);
+    }
+    return out;
+}
+
+static void bench_running_median_setup(const uint16_t *x, int n)
+{
+    static uint16_t hist[FILTER_MEDIAN_BINS];
+    static uint16_t buf[FILTER_BENCH_MAX];
+    int out;
+
+    filter_median_init(&bench_med, hist, buf, n);
+    bench_pos = 0;
+    for (int i = 0; i < n; i++) {
+        filter_median_update(&bench_med, bench_next(x), &out);
+    }
+}
+
+static int bench_running_median(const uint16_t *x, int n)
+{
+    int out = 0;
+
+    for (int i = 0; i < n; i++) {
+        filter_median_update(&bench_med, bench_next(x), &out);
+    }
+    return out;
+}
+
+/** Low-pass biquad, cut-off at fs / 20, Q = 0.707 */
+static const int16_t bench_lowpass[5] = { 329, 658, 329, -25576, 10508 };
+/** 16-tap boxcar FIR */
+static const int16_t bench_boxcar[16] = { [0 ... 15] = BIT(15) / 16 };
+
+static const struct filter_stage bench_median_stages[] = { FILTER_MEDIAN_STAGE(5) };
+static const struct filter_stage bench_fir_stages[] = { FILTER_FIR_STAGE(bench_boxcar) };
+static const struct filter_stage bench_biquad_stages[] = { FILTER_BIQUAD_STAGE(bench_lowpass) };
+static const struct filter_stage bench_chain_stages[] = {
+    FILTER_MEDIAN_STAGE(5),
+    FILTER_BIQUAD_STAGE(bench_lowpass),
+};
+
+static const struct filter_chain bench_median = FILTER_CHAIN(bench_median_stages);
+static const struct filter_chain bench_fir = FILTER_CHAIN(bench_fir_stages);
+static const struct filter_chain bench_biquad = FILTER_CHAIN(bench_biquad_stages);
+static const struct filter_chain bench_chain = FILTER_CHAIN(bench_chain_stages);
+
+/** Empties the bench chains; their windows are short, the first run fills them */
+static void bench_chain_setup(const uint16_t *x, int n)
+{
+    filter_chain_init(&bench_median);
+    filter_chain_init(&bench_fir);
+    filter_chain_init(&bench_biquad);
+    filter_chain_init(&bench_chain);
+}
+
+/** Runs the n valid samples of x through chain, as channel index 0 */
+static int bench_chain_run(const struct filter_chain *chain, const uint16_t *x, int n)
+{
+    int out = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (ADC_ACQ_VALID(x[i])) {
+            out = filter_chain_run(chain, 0, x[i]);
+        }
+    }
+    return out;
+}
+
+static int bench_median5(const uint16_t *x, int n)
+{
+    return bench_chain_run(&bench_median, x, n);
+}
+
+static int bench_fir16(const uint16_t *x, int n)
+{
+    return bench_chain_run(&bench_fir, x, n);
+}
+
+static int bench_biquad1(const uint16_t *x, int n)
+{
+    return bench_chain_run(&bench_biquad, x, n);
+}
+
+static int bench_median_biquad(const uint16_t *x, int n)
+{
+    return bench_chain_run(&bench_chain, x, n);
+}
+
+/** The window in q15 for the dsp kernels: invalid samples as 0, scaled
+ * by 2^FILTER_IIR_GUARD as the biquad stage does */
+static int16_t bench_q15[FILTER_BENCH_MAX];
+static int16_t bench_q15_out[FILTER_BENCH_MAX];
+
+/** Runs the 16-tap boxcar over the first n samples of bench_q15 into out,
+ * DSP_FIR_MAX_BLOCK samples per call */
+static int bench_fir_block(void (*fir)(struct dsp_fir *, const int16_t *, int16_t *, uint32_t),
+                           int16_t *out, int n)
+{
+    static struct dsp_fir f;
+
+    dsp_fir_init(&f, bench_boxcar, ARRAY_SIZE(bench_boxcar));
+    for (int i = 0; i < n; i += DSP_FIR_MAX_BLOCK) {
+        fir(&f, &bench_q15[i], &out[i], MIN(n - i, DSP_FIR_MAX_BLOCK));
+    }
+    return out[n - 1];
+}
+
+/** Runs the low-pass biquad over the first n samples of bench_q15 into out */
+static int bench_biquad_block(void (*biquad)(struct dsp_biquad *, const int16_t *, int16_t *, uint32_t),
+                              int16_t *out, int n)
+{
+    static struct dsp_biquad f;
+
+    dsp_biquad_init(&f, bench_lowpass, 1);
+    biquad(&f, bench_q15, out, n);
+    return out[n - 1];
+}
+
+static int bench_dsp_mean(const uint16_t *x, int n)
+{
+    return dsp_mean_q15(bench_q15, n);
+}
+
+static int bench_dsp_fir(const uint16_t *x, int n)
+{
+    return bench_fir_block(dsp_fir_q15, bench_q15_out, n);
+}
+
+static int bench_dsp_biquad(const uint16_t *x, int n)
+{
+    return bench_biquad_block(dsp_biquad_q15, bench_q15_out, n);
+}
+
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+static int16_t bench_q15_out_c[FILTER_BENCH_MAX];
+
+static int bench_dsp_mean_c(const uint16_t *x, int n)
+{
+    return dsp_mean_q15_c(bench_q15, n);
+}
+
+static int bench_dsp_fir_c(const uint16_t *x, int n)
+{
+    return bench_fir_block(dsp_fir_q15_c, bench_q15_out_c, n);
+}
+
+static int bench_dsp_biquad_c(const uint16_t *x, int n)
+{
+    return bench_biquad_block(dsp_biquad_q15_c, bench_q15_out_c, n);
+}
+
+/** Checks that the library and the portable kernels agree on every output */
+static void bench_dsp_compare(void)
+{
+    int n = FILTER_BENCH_MAX;
+    bool same = dsp_mean_q15(bench_q15, n) == dsp_mean_q15_c(bench_q15, n);
+
+    bench_dsp_fir(NULL, n);
+    bench_dsp_fir_c(NULL, n);
+    same &= memcmp(bench_q15_out, bench_q15_out_c, sizeof(bench_q15_out)) == 0;
+    bench_dsp_biquad(NULL, n);
+    bench_dsp_biquad_c(NULL, n);
+    same &= memcmp(bench_q15_out, bench_q15_out_c, sizeof(bench_q15_out)) == 0;
+    printk("q15 kernels, " DSP_KERNELS " vs portable C: %s\n", same ? "bit-identical" : "DIFFERENT");
+}
+#endif /* CONFIG_APP_FILTER_CMSIS_DSP */
+
+/** Checks that the median chain stage and the histogram median give the
+ * same outputs, from empty windows on */
+static void bench_median_compare(const uint16_t *x)
+{
+    static uint16_t hist[FILTER_MEDIAN_BINS];
+    uint16_t buf[5];
+    struct filter_median med;
+    int out = 0;
+    int i;
+
+    filter_chain_init(&bench_median);
+    filter_median_init(&med, hist, buf, ARRAY_SIZE(buf));
+    for (i = 0; i < FILTER_BENCH_MAX; i++) {
+        if (!ADC_ACQ_VALID(x[i])) {
+            continue;
+        }
+        filter_median_update(&med, x[i], &out);
+        if (filter_chain_run(&bench_median, 0, x[i]) != out) {
+            break;
+        }
+    }
+    if (i == FILTER_BENCH_MAX) {
+        printk("median 5, chain stage vs histogram: same outputs\n");
+    } else {
+        printk("median 5, chain stage vs histogram: DIFFERENT from sample %d\n", i);
+    }
+}
+
+/** One measured kernel: filters the window x of n samples, returns the output */
+struct filter_bench_kernel {
+    const char *name;
+    int (*run)(const uint16_t *x, int n);
+    bool per_sample;        /* Streaming filter: cycles per sample, not per window */
+    void (*setup)(const uint16_t *x, int n);   /* Untimed, before the runs on windows of n */
+};
+
+static const struct filter_bench_kernel filter_bench_kernels[] = {
+    { "band mean (double)", bench_band_mean_double, false },
+    { "band mean", bench_band_mean, false },
+    { "moving average", bench_moving_average, true, bench_moving_average_setup },
+    { "running median", bench_running_median, true, bench_running_median_setup },
+    { "median 5", bench_median5, true, bench_chain_setup },
+    { "FIR 16 taps", bench_fir16, true, bench_chain_setup },
+    { "biquad", bench_biquad1, true, bench_chain_setup },
+    { "median 5 + biquad", bench_median_biquad, true, bench_chain_setup },
+    /* The q15 kernels alone, on whole blocks */
+    { "q15 mean", bench_dsp_mean, false },
+    { "q15 FIR 16 taps", bench_dsp_fir, true },
+    { "q15 biquad", bench_dsp_biquad, true },
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+    { "q15 mean (C)", bench_dsp_mean_c, false },
+    { "q15 FIR 16 taps (C)", bench_dsp_fir_c, true },
+    { "q15 biquad (C)", bench_dsp_biquad_c, true },
+#endif
+};
+
+void filter_bench(void)
+{
+    static uint16_t x[FILTER_BENCH_MAX];
+    const struct filter_bench_kernel *k;
+    timing_t start, end;
+    uint64_t cycles;
+    volatile int sink;
+
+    /* A noisy level with an outlier every 8 samples and one invalid sample */
+    for (int i = 0; i < FILTER_BENCH_MAX; i++) {
+        x[i] = (i % 8 == 7) ? 1000 : 500 + (i * 7) % 21 - 10;
+    }
+    x[5] = ADC_ACQ_INVALID;
+    for (int i = 0; i < FILTER_BENCH_MAX; i++) {
+        bench_q15[i] = ADC_ACQ_VALID(x[i]) ? x[i] << FILTER_IIR_GUARD : 0;
+    }
+
+    timing_init();
+    timing_start();
+
+    printk("Filter bench (" DSP_KERNELS " kernels): cycles per window (per sample for streaming filters)\n");
+    printk("%-20s", "window");
+    for (int j = 0; j < ARRAY_SIZE(filter_bench_len); j++) {
+        printk(" %8d", filter_bench_len[j]);
+    }
+    printk("\n");
+
+    for (int i = 0; i < ARRAY_SIZE(filter_bench_kernels); i++) {
+        k = &filter_bench_kernels[i];
+        printk("%-20s", k->name);
+        for (int j = 0; j < ARRAY_SIZE(filter_bench_len); j++) {
+            if (k->setup) {
+                k->setup(x, filter_bench_len[j]);
+            }
+            start = timing_counter_get();
+            for (int r = 0; r < FILTER_BENCH_RUNS; r++) {
+                /* The window may have changed: nothing is hoisted out of the loop */
+                compiler_barrier();
+                sink = k->run(x, filter_bench_len[j]);
+            }
+            end = timing_counter_get();
+            cycles = timing_cycles_get(&start, &end) / FILTER_BENCH_RUNS;
+            if (k->per_sample) {
+                cycles /= filter_bench_len[j];
+            }
+            printk(" %8u", (uint32_t)cycles);
+        }
+        /* Output on the largest window, to check the versions agree */
+        printk("  (%d)\n", sink);
+    }
+    bench_median_compare(x);
+#if defined(CONFIG_APP_FILTER_CMSIS_DSP)
+    bench_dsp_compare();
+#endif
+}
+
+#endif /* CONFIG_APP_FILTER_BENCH */
@@ -0,0 +1,213 @@
+/** @file filter.h
+ * @brief Fixed-point filter stages of thread B.
+ *
+ * The stages work on the samples of one channel in a window, n samples
+ * stride apart, so they run in place on a DMA block as well as on a copied
+ * window of scans. Streaming stages instead take one sample at a time
+ * and keep their state between calls. Samples flagged ADC_ACQ_INVALID are skipped. There is no
+ * floating point: CONFIG_FPU is off, and every double operation would be a
+ * soft-float library call.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <zephyr.h>
+
+#include "adc_acq.h"
+#include "dsp.h"
+
+/** Rejection band of filter_band_mean() selected in Kconfig (per mille of the mean) */
+#define FILTER_BAND_PM CONFIG_APP_FILTER_BAND_PERMILLE
+
+/** Outlier-rejecting mean: the mean of the valid samples within band_pm
+ * per mille of their mean (bounds included). Returns the number of samples
+ * averaged into *out. If no valid sample is within the band, *out is the
+ * mean of all the valid ones and their number is returned negated. Returns
+ * 0 if there was no valid sample (*out is left unchanged). */
+int filter_band_mean(const uint16_t *x, int n, int stride, uint32_t band_pm, int *out);
+
+/** Moving average of one channel: a running sum over a circular window of
+ * the last len valid samples, so each output costs O(1) whatever len */
+struct filter_ma {
+    uint16_t *buf;          /* The last len samples */
+    uint32_t mask;          /* len - 1 */
+    uint32_t idx;           /* Slot of the oldest sample, where the next one goes */
+    uint32_t count;         /* Samples in the window, len once full */
+    uint32_t sum;
+    uint8_t shift;          /* log2(len): the mean is a shift */
+};
+
+/** Moving average length selected in Kconfig */
+#if defined(CONFIG_APP_FILTER_MA_LENGTH)
+#define FILTER_MA_LENGTH CONFIG_APP_FILTER_MA_LENGTH
+#endif
+
+/** Empties f, which averages len samples (a power of two) kept in buf */
+void filter_ma_init(struct filter_ma *f, uint16_t *buf, uint32_t len);
+
+/** Adds sample v to f, unless it is flagged ADC_ACQ_INVALID, and sets *out
+ * to the mean of the window (of fewer samples until it is full). Returns
+ * the number of samples in the window, 0 before the first valid one (*out
+ * is left unchanged). */
+int filter_ma_update(struct filter_ma *f, uint16_t v, int *out);
+
+/** Running median of one channel over the last len valid samples. The
+ * window is kept as a histogram of the 10-bit codes with a pointer to the
+ * median code, which each sample moves by one rank: no sorting, and a
+ * cost per sample that does not grow with len. */
+struct filter_median {
+    uint16_t *hist;         /* Samples per code, FILTER_MEDIAN_BINS of them */
+    uint16_t *buf;          /* The last len samples, oldest at idx once full */
+    uint16_t len;
+    uint16_t idx;
+    uint16_t count;         /* Samples in the window, len once full */
+    uint16_t med;           /* Median code */
+    uint16_t below;         /* Samples below med */
+};
+
+/** Histogram bins of a running median: one per ADC code */
+#define FILTER_MEDIAN_BINS (ADC_ACQ_MAX_VALUE + 1)
+
+/** Running median length selected in Kconfig */
+#if defined(CONFIG_APP_FILTER_MEDIAN_LENGTH)
+#define FILTER_MEDIAN_LENGTH CONFIG_APP_FILTER_MEDIAN_LENGTH
+#endif
+
+/** Empties f, the median of len samples kept in buf, with the histogram
+ * hist of FILTER_MEDIAN_BINS counts */
+void filter_median_init(struct filter_median *f, uint16_t *hist, uint16_t *buf, uint16_t len);
+
+/** Adds sample v to f, unless it is flagged ADC_ACQ_INVALID, and sets *out
+ * to the median of the window (the lower one for an even number of
+ * samples). Returns the number of samples in the window, 0 before the
+ * first valid one (*out is left unchanged). */
+int filter_median_update(struct filter_median *f, uint16_t v, int *out);
+
+/** Stage types of a filter chain */
+enum filter_type {
+    FILTER_MA,              /* Moving average of len samples (a power of two) */
+    FILTER_FIR,             /* FIR of len Q15 taps, see dsp_fir_q15() */
+    FILTER_BIQUAD,          /* Second-order IIR, Q14 b0 b1 b2 a1 a2 (a0 = 1), see dsp_biquad_q15() */
+    FILTER_MEDIAN,          /* Running median of len samples (odd) */
+};
+
+/** Longest FIR of a chain (taps) */
+#define FILTER_FIR_MAX_TAPS DSP_FIR_MAX_TAPS
+/** Longest running median of a chain (samples) */
+#define FILTER_MEDIAN_MAX 31
+/** Longest moving average of a chain (samples) */
+#define FILTER_CHAIN_MA_MAX 64
+
+/** State of one stage for one channel */
+union filter_state {
+    struct dsp_fir fir;
+    struct dsp_biquad biquad;               /* Inputs and outputs scaled by 2^FILTER_IIR_GUARD */
+    struct {
+        uint16_t ring[FILTER_MEDIAN_MAX];   /* Last len inputs, oldest at idx once full */
+        uint16_t sorted[FILTER_MEDIAN_MAX]; /* The same inputs, in increasing order */
+        uint16_t idx;
+        uint16_t count;
+    } median;
+    struct {
+        struct filter_ma ma;
+        uint16_t buf[FILTER_CHAIN_MA_MAX];
+    } ma;
+};
+
+/** Fraction bits the biquad keeps on its inputs and outputs, so small
+ * steps of a low cut-off are not rounded away. 1023 << 4 still fits in q15. */
+#define FILTER_IIR_GUARD 4
+
+/** One stage of a chain: its type, parameters, and state for every channel */
+struct filter_stage {
+    enum filter_type type;
+    const int16_t *coef;            /* FIR taps or biquad coefficients */
+    uint16_t len;                   /* FIR taps, median or moving average length */
+    union filter_state *state;      /* One per channel index */
+};
+
+/** Defines a stage in a chain table at file scope, with state for every
+ * channel. Each table row keeps its own state, even when two chains look
+ * alike. */
+#define FILTER_STAGE(_type, _coef, _len) \
+    { .type = (_type), .coef = (_coef), .len = (_len), \
+      .state = (union filter_state[ADC_ACQ_NUM_CHANNELS]){ } }
+#define FILTER_MA_STAGE(_len) FILTER_STAGE(FILTER_MA, NULL, _len)
+#define FILTER_FIR_STAGE(_coef) FILTER_STAGE(FILTER_FIR, _coef, ARRAY_SIZE(_coef))
+#define FILTER_BIQUAD_STAGE(_coef) FILTER_STAGE(FILTER_BIQUAD, _coef, 5)
+#define FILTER_MEDIAN_STAGE(_len) FILTER_STAGE(FILTER_MEDIAN, NULL, _len)
+
+/** Stages applied in order to the samples of one channel */
+struct filter_chain {
+    const struct filter_stage *stages;
+    uint8_t n;
+};
+
+#define FILTER_CHAIN(_stages) { .stages = (_stages), .n = ARRAY_SIZE(_stages) }
+
+/** Empties the state of every stage of chain, for every channel */
+void filter_chain_init(const struct filter_chain *chain);
+
+/* One sample through one stage, for channel index c. Outputs stay within
+ * 0..ADC_ACQ_MAX_VALUE. */
+int filter_ma_step(const struct filter_stage *s, int c, int v);
+int filter_fir_step(const struct filter_stage *s, int c, int v);
+int filter_biquad_step(const struct filter_stage *s, int c, int v);
+int filter_median_step(const struct filter_stage *s, int c, int v);
+
+/** Runs the valid sample v of channel index c through chain and returns
+ * the output. Inlined, so where chain is known at compile time (a const
+ * chain, not a table entry picked at run time) the loop and the switch can
+ * fold into direct calls. Thread B picks the chain of each channel at run
+ * time, so there each stage still goes through the switch. */
+static ALWAYS_INLINE int filter_chain_run(const struct filter_chain *chain, int c, int v)
+{
+    for (int i = 0; i < chain->n; i++) {
+        const struct filter_stage *s = &chain->stages[i];
+
+        switch (s->type) {
+        case FILTER_MA:
+            v = filter_ma_step(s, c, v);
+            break;
+        case FILTER_FIR:
+            v = filter_fir_step(s, c, v);
+            break;
+        case FILTER_BIQUAD:
+            v = filter_biquad_step(s, c, v);
+            break;
+        case FILTER_MEDIAN:
+            v = filter_median_step(s, c, v);
+            break;
+        }
+    }
+    return v;
+}
+
+/** Samples that filter_chain_run_block() passes through each stage at once */
+#define FILTER_CHAIN_BLOCK DSP_FIR_MAX_BLOCK
+
+/* n valid samples (at most FILTER_CHAIN_BLOCK) through one stage, in place,
+ * for channel index c. FIR and biquad stages filter them in one call of the
+ * q15 kernels. */
+void filter_fir_block(const struct filter_stage *s, int c, int16_t *x, int n);
+void filter_biquad_block(const struct filter_stage *s, int c, int16_t *x, int n);
+
+/** Runs the n samples of channel index c in x, stride apart, through chain
+ * a block at a time, skipping those flagged ADC_ACQ_INVALID. Sets *out to
+ * the output of the last valid sample and returns the number of valid
+ * samples, or 0 if there was none (*out is left unchanged). */
+int filter_chain_run_block(const struct filter_chain *chain, int c, const uint16_t *x, int n,
+                           int stride, int *out);
+
+#if defined(CONFIG_APP_FILTER_BENCH)
+/** Prints the cycles each filter takes on synthetic windows of several
+ * lengths, next to those of the double precision band test that thread B
+ * used to run */
+void filter_bench(void);
+#endif
+
+#endif /* FILTER_H */
@@ -0,0 +1,86 @@
+/** @file latency.c
+ * @brief End-to-end latency histogram implementation.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <sys/printk.h>
+
+#include "latency.h"
+
+void latency_init(struct latency_hist *h, const char *name)
+{
+    k_spinlock_key_t key = k_spin_lock(&h->lock);
+
+    h->name = name;
+    memset(h->bucket, 0, sizeof(h->bucket));
+    h->count = 0;
+    h->min_us = UINT32_MAX;
+    h->max_us = 0;
+    h->sum_us = 0;
+    k_spin_unlock(&h->lock, key);
+}
+
+void latency_record(struct latency_hist *h, uint32_t capture)
+{
+    /* Unsigned difference: correct across one wrap of the cycle counter */
+    uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - capture);
+    /* Bucket of the highest bit set, one count-leading-zeros instruction */
+    int i = us > 1 ? 31 - __builtin_clz(us) : 0;
+    k_spinlock_key_t key = k_spin_lock(&h->lock);
+
+    h->bucket[MIN(i, LATENCY_BUCKETS - 1)]++;
+    h->count++;
+    h->min_us = MIN(h->min_us, us);
+    h->max_us = MAX(h->max_us, us);
+    h->sum_us += us;
+    k_spin_unlock(&h->lock, key);
+}
+
+void latency_get(struct latency_hist *h, struct latency_stats *st)
+{
+    k_spinlock_key_t key = k_spin_lock(&h->lock);
+
+    memcpy(st->bucket, h->bucket, sizeof(st->bucket));
+    st->count = h->count;
+    st->min_us = h->count ? h->min_us : 0;
+    st->max_us = h->max_us;
+    st->avg_us = h->count ? (uint32_t)(h->sum_us / h->count) : 0;
+    k_spin_unlock(&h->lock, key);
+}
+
+uint32_t latency_percentile_us(const struct latency_stats *st, uint32_t per_mille)
+{
+    uint64_t rank = ((uint64_t)st->count * per_mille + 999) / 1000;
+    uint32_t seen = 0;
+
+    for (int i = 0; i < LATENCY_BUCKETS - 1; i++) {
+        seen += st->bucket[i];
+        if (seen >= rank) {
+            return latency_bucket_us(i + 1);
+        }
+    }
+    /* Only the open-ended last bucket is left */
+    return st->max_us;
+}
+
+void latency_report(struct latency_hist *h)
+{
+    struct latency_stats st;
+
+    latency_get(h, &st);
+    if (st.count == 0) {
+        return;
+    }
+    printk("Latency %s: %u values, min %u us, avg %u us, p50 < %u us, p99 < %u us, max %u us\n",
+           h->name, st.count, st.min_us, st.avg_us, latency_percentile_us(&st, 500),
+           latency_percentile_us(&st, 990), st.max_us);
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        if (st.bucket[i]) {
+            printk("  >= %u us: %u\n", latency_bucket_us(i), st.bucket[i]);
+        }
+    }
+}
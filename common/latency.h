@@ -0,0 +1,64 @@
+/** @file latency.h
+ * @brief End-to-end latency histogram of the pipeline.
+ *
+ * Every sample carries the k_cycle_get_32() stamp of its capture through
+ * threads A and B. When thread C writes a value to the LED, the age of the
+ * newest sample behind it goes into a histogram of fixed power-of-two
+ * buckets: bucket 0 counts latencies below 2 us, bucket i those in
+ * [2^i, 2^(i+1)) us and the last one everything above. Recording is O(1)
+ * and any thread can read the histogram while it is being filled.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <zephyr.h>
+
+/** Histogram buckets: the last one starts at 2^(LATENCY_BUCKETS - 1) us (about 8 s) */
+#define LATENCY_BUCKETS 24
+
+/** Latency histogram. Written by one thread, see latency_get() for readers. */
+struct latency_hist {
+    const char *name;               /* Printed by latency_report() */
+    struct k_spinlock lock;
+    uint32_t bucket[LATENCY_BUCKETS];
+    uint32_t count;                 /* Recorded latencies */
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+};
+
+/** Counters of a histogram, see latency_get() */
+struct latency_stats {
+    uint32_t bucket[LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint32_t avg_us;
+};
+
+/** Empties h */
+void latency_init(struct latency_hist *h, const char *name);
+
+/** Records the time elapsed since capture, a k_cycle_get_32() stamp */
+void latency_record(struct latency_hist *h, uint32_t capture);
+
+/** Copies the counters of h, consistent with each other, from any thread */
+void latency_get(struct latency_hist *h, struct latency_stats *st);
+
+/** Lower bound of bucket i (us) */
+static inline uint32_t latency_bucket_us(int i)
+{
+    return i ? BIT(i) : 0;
+}
+
+/** Smallest bucket bound (us) not exceeded by per_mille / 1000 of the latencies */
+uint32_t latency_percentile_us(const struct latency_stats *st, uint32_t per_mille);
+
+/** Prints the summary and the non-empty buckets of h */
+void latency_report(struct latency_hist *h);
+
+#endif /* LATENCY_H */
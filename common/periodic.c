@@ -0,0 +1,105 @@
+/** @file periodic.c
+ * @brief Periodic task runtime with absolute releases and overrun policies.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+
+#include "periodic.h"
+
+void periodic_init(struct periodic_task *t, const char *name, uint32_t period_ms,
+                   uint32_t phase_ms, uint32_t deadline_ms, enum periodic_overrun policy)
+{
+    t->name = name;
+    t->period = k_ms_to_ticks_ceil64(period_ms);
+    t->phase = k_ms_to_ticks_ceil64(phase_ms);
+    t->deadline = deadline_ms ? k_ms_to_ticks_ceil64(deadline_ms) : t->period;
+    t->policy = policy;
+    t->release = 0;
+    t->jobs = 0;
+    t->missed = 0;
+    t->skipped = 0;
+    t->reported = 0;
+}
+
+void periodic_start(struct periodic_task *t)
+{
+    t->release = k_uptime_ticks() + t->phase;
+    k_sleep(K_TIMEOUT_ABS_TICKS(t->release));
+}
+
+void periodic_set_period(struct periodic_task *t, uint32_t period_ms)
+{
+    k_ticks_t period = k_ms_to_ticks_ceil64(period_ms);
+
+    if (t->deadline == t->period) {
+        t->deadline = period;
+    }
+    t->period = period;
+}
+
+/** Accounts for the job released at t->release that ended at now */
+static void periodic_job_end(struct periodic_task *t, int64_t now)
+{
+    t->jobs++;
+    if (now > t->release + t->deadline) {
+        t->missed++;
+    }
+}
+
+void periodic_wait_next(struct periodic_task *t)
+{
+    int64_t now = k_uptime_ticks();
+    int64_t next = t->release + t->period;
+
+    periodic_job_end(t, now);
+
+    /* Overrun: one or more releases already passed. A job that ends right
+     * on the next release is on time. */
+    if (now > next) {
+        switch (t->policy) {
+        case PERIODIC_OVERRUN_SKIP: {
+            int64_t late = (now - next) / t->period + 1;   /* Releases in the past */
+
+            next += late * t->period;
+            t->skipped += (uint32_t)late;
+            break;
+        }
+        case PERIODIC_OVERRUN_CATCH_UP:
+            /* Release right away; the grid is kept */
+            break;
+        case PERIODIC_OVERRUN_RESYNC:
+            next = now;
+            break;
+        }
+    }
+
+    t->release = next;
+    if (next > now) {
+        k_sleep(K_TIMEOUT_ABS_TICKS(next));
+    }
+}
+
+void periodic_job_release(struct periodic_task *t)
+{
+    t->release = k_uptime_ticks();
+}
+
+void periodic_job_done(struct periodic_task *t)
+{
+    periodic_job_end(t, k_uptime_ticks());
+}
+
+void periodic_report(struct periodic_task *t)
+{
+    if (t->missed == t->reported) {
+        return;
+    }
+    t->reported = t->missed;
+    printk("%s: %u of %u jobs missed the %u ms deadline, %u releases skipped\n",
+           t->name, t->missed, t->jobs, (uint32_t)k_ticks_to_ms_ceil64(t->deadline),
+           t->skipped);
+}
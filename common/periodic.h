@@ -0,0 +1,81 @@
+/** @file periodic.h
+ * @brief Periodic task runtime shared by the fifo and ShareMem pipelines.
+ *
+ * A task has a period, a phase (offset of its first release) and a
+ * relative deadline. Releases are absolute kernel ticks, so the time a
+ * job takes does not accumulate as drift, and a job that ends after
+ * release + deadline is counted as a missed deadline. When a job runs
+ * past the next release, the overrun policy decides what happens to the
+ * releases that were missed.
+ *
+ * Event-driven tasks (released by data from the previous stage instead
+ * of by the clock) use periodic_job_release()/periodic_job_done() to get
+ * the same deadline accounting.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+#include <zephyr.h>
+
+/** What a periodic task does with releases that passed while a job overran */
+enum periodic_overrun {
+    PERIODIC_OVERRUN_SKIP,      /* Drop them, wait for the next release on the original grid */
+    PERIODIC_OVERRUN_CATCH_UP,  /* Run them back-to-back until the task is on time again */
+    PERIODIC_OVERRUN_RESYNC,    /* Release now and restart the grid from the end of the late job */
+};
+
+/** Overrun policy selected in Kconfig */
+#if defined(CONFIG_APP_PERIODIC_OVERRUN_CATCH_UP)
+#define PERIODIC_OVERRUN_DEFAULT PERIODIC_OVERRUN_CATCH_UP
+#elif defined(CONFIG_APP_PERIODIC_OVERRUN_RESYNC)
+#define PERIODIC_OVERRUN_DEFAULT PERIODIC_OVERRUN_RESYNC
+#else
+#define PERIODIC_OVERRUN_DEFAULT PERIODIC_OVERRUN_SKIP
+#endif
+
+/** Timing parameters and counters of one task. All times in kernel ticks. */
+struct periodic_task {
+    const char *name;               /* Printed by periodic_report() */
+    k_ticks_t period;
+    k_ticks_t phase;
+    k_ticks_t deadline;             /* Relative to the release of each job */
+    enum periodic_overrun policy;
+    int64_t release;                /* Absolute release of the current job */
+    uint32_t jobs;                  /* Completed jobs */
+    uint32_t missed;                /* Jobs that ended after their deadline */
+    uint32_t skipped;               /* Releases dropped by PERIODIC_OVERRUN_SKIP */
+    uint32_t reported;              /* Value of missed at the last report */
+};
+
+/** Sets the timing parameters of a task (times in ms). A deadline of 0 means
+ * an implicit deadline, equal to the period. */
+void periodic_init(struct periodic_task *t, const char *name, uint32_t period_ms,
+                   uint32_t phase_ms, uint32_t deadline_ms, enum periodic_overrun policy);
+
+/** Anchors the release grid at the current time plus the phase and sleeps
+ * until the first release. */
+void periodic_start(struct periodic_task *t);
+
+/** Changes the period from the next release on. An implicit deadline
+ * (equal to the period) follows the new period. Must be called by the
+ * task itself. */
+void periodic_set_period(struct periodic_task *t, uint32_t period_ms);
+
+/** Ends the current job (deadline check) and sleeps until the next release
+ * given by the overrun policy. */
+void periodic_wait_next(struct periodic_task *t);
+
+/** Event-driven tasks: the current job is released now. */
+void periodic_job_release(struct periodic_task *t);
+
+/** Event-driven tasks: the current job is done (deadline check). */
+void periodic_job_done(struct periodic_task *t);
+
+/** Prints the counters of a task if it missed deadlines since the last report. */
+void periodic_report(struct periodic_task *t);
+
+#endif /* PERIODIC_H */
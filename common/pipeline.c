@@ -0,0 +1,753 @@
+/** @file pipeline.c
+ * @brief This program implements cooperative tasks in Zephyr.
+ *
+ *
+ * It does a basic processing of an analog signal in three threads: A reads
+ * the ADC, B filters and C drives the LED. The transport between them is
+ * selected in Kconfig (see channel.h); the fifo and ShareMem applications
+ * build this same source with their own default.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ * @bug There are no bugs
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/gpio.h>
+#include <drivers/pwm.h>
+#include <sys/printk.h>
+#include <sys/__assert.h>
+#include <string.h>
+#include <timing/timing.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <devicetree.h>
+#include <drivers/adc.h>
+
+/** ADC acquisition layer (see common/adc_acq.h) */
+#include "adc_acq.h"
+/** Periodic task runtime (see common/periodic.h) */
+#include "periodic.h"
+/** Triggered burst capture (see common/capture.h) */
+#include "capture.h"
+/** Adaptive sampling rate (see common/rate.h) */
+#include "rate.h"
+/** Inter-stage transport (see common/channel.h) */
+#include "channel.h"
+/** End-to-end latency histogram (see common/latency.h) */
+#include "latency.h"
+/** Fixed-point filter stages (see common/filter.h) */
+#include "filter.h"
+
+/* Other defines */
+/** Interval between ADC samples */
+#define TIMER_INTERVAL_MSEC 1
+
+/** Refer to dts file */
+#define GPIO0_NID DT_NODELABEL(gpio0)
+/** Refer to dts file */
+#define PWM0_NID DT_NODELABEL(pwm0)
+/** Refer to dts file */
+#define BOARDLED1 0x0d /* Pin at which LED1 is connected.  Addressing is direct (i.e., pin number) */
+/** Refer to dts file */
+#define BOARDBUT1 0x0b /* Pin at which BUT1 is connected.  Addressing is direct (i.e., pin number) */
+/** Refer to dts file */
+#define BOARDBUT2 0x0c /* Pin at which BUT2 is connected.  Addressing is direct (i.e., pin number) */
+
+/** Largest LED value (full duty cycle), the ADC full scale */
+#define LED_MAX 1023
+/** Setpoint change per press of button 2 */
+#define LED_SETPOINT_STEP ((LED_MAX + 1) / 8)
+/** Presses closer than this to the previous one are contact bounce (ms) */
+#define BUTTON_DEBOUNCE_MS 50
+
+/** Size of stack area used by each thread (can be thread specific)*/
+#define STACK_SIZE 1024
+
+/** Thread scheduling priority */
+#define thread_A_prio 1
+/** Thread scheduling priority */
+#define thread_B_prio 1
+/** Thread scheduling priority */
+#define thread_C_prio 1
+
+/** Therad periodicity (in ms)*/
+#define thread_A_period CONFIG_APP_THREAD_A_PERIOD_MS
+/** Offset of the first release of thread A (in ms) */
+#define thread_A_phase 0
+
+/** Thread A relative deadline (in ms). When the acquisition sets the pace,
+ * a block must be handled before the next one is complete. */
+#if defined(CONFIG_APP_ACQ_TIMER)
+#define thread_A_deadline MAX(1, ADC_ACQ_BLOCK_SIZE * TIMER_INTERVAL_MSEC)
+#elif defined(CONFIG_APP_ACQ_HW_TIMED) || defined(CONFIG_APP_ACQ_BLOCK)
+#define thread_A_deadline MAX(1, ADC_ACQ_BLOCK_SIZE * 1000 / CONFIG_APP_ACQ_RATE_HZ)
+#else
+#define thread_A_deadline thread_A_period
+#endif
+/** Thread B relative deadline (in ms), from the arrival of its input */
+#define thread_B_deadline 20
+/** Thread C relative deadline (in ms), from the arrival of its input */
+#define thread_C_deadline 20
+/** Period of the thread B throughput report (in ms) */
+#if defined(CONFIG_APP_ACQ_STATS_PERIOD_MS)
+#define thread_B_report_period CONFIG_APP_ACQ_STATS_PERIOD_MS
+#else
+#define thread_B_report_period 5000
+#endif
+
+/** Prints a value passed between the threads, only with APP_TRACE_VALUES */
+#define TRACE(...) do { if(IS_ENABLED(CONFIG_APP_TRACE_VALUES)) { printk(__VA_ARGS__); } } while(0)
+
+#if defined(CONFIG_APP_FILTER_MOVING_AVERAGE)
+/** Number of values of a channel thread B takes per output: it filters them as they come */
+#define FILTER_WINDOW 1
+/** Number of values of a channel behind each output of thread B */
+#define FILTER_SPAN FILTER_MA_LENGTH
+BUILD_ASSERT(IS_POWER_OF_TWO(FILTER_MA_LENGTH), "APP_FILTER_MA_LENGTH must be a power of two");
+#elif defined(CONFIG_APP_FILTER_MEDIAN)
+/** Number of values of a channel thread B takes per output: it filters them as they come */
+#define FILTER_WINDOW 1
+/** Number of values of a channel behind each output of thread B */
+#define FILTER_SPAN FILTER_MEDIAN_LENGTH
+#elif defined(CONFIG_APP_FILTER_CHAIN)
+/** Number of values of a channel thread B filters per output, a block at a time */
+#define FILTER_WINDOW CONFIG_APP_FILTER_WINDOW
+/** Number of values of a channel behind each output of thread B */
+#define FILTER_SPAN FILTER_WINDOW
+#else
+/** Number of values of a channel averaged by thread B into one output */
+#define FILTER_WINDOW CONFIG_APP_FILTER_WINDOW
+/** Number of values of a channel behind each output of thread B */
+#define FILTER_SPAN FILTER_WINDOW
+#endif
+
+/* Global vars */
+struct k_timer my_timer;
+
+/** Create thread stack space */
+K_THREAD_STACK_DEFINE(thread_A_stack, STACK_SIZE);
+/** Create thread stack space */
+K_THREAD_STACK_DEFINE(thread_B_stack, STACK_SIZE);
+/** Create thread stack space */
+K_THREAD_STACK_DEFINE(thread_C_stack, STACK_SIZE);
+
+/* Create variables for thread data */
+struct k_thread thread_A_data;
+struct k_thread thread_B_data;
+struct k_thread thread_C_data;
+
+/* Create task IDs */
+k_tid_t thread_A_tid;
+k_tid_t thread_B_tid;
+k_tid_t thread_C_tid;
+
+/* Timing parameters and deadline counters of each thread */
+struct periodic_task task_A;
+struct periodic_task task_B;
+struct periodic_task task_C;
+
+/** Age of the newest sample behind each LED value, from its capture to the PWM write */
+struct latency_hist adc_to_led;
+
+#if defined(CONFIG_APP_ACQ_ZERO_COPY)
+/* The A -> B element is a whole block, by reference: one block is one window */
+BUILD_ASSERT(ADC_ACQ_BLOCK_SIZE / ADC_ACQ_DECIMATION == FILTER_WINDOW,
+             "With APP_ACQ_ZERO_COPY, APP_FILTER_WINDOW must be APP_ACQ_BLOCK_SIZE / APP_ACQ_DECIMATION");
+/** Sample of channel c in scan i of the window thread B is averaging */
+#define WIN_SAMPLE(i, c) ADC_ACQ_SAMPLE(&win, (i) * ADC_ACQ_DECIMATION, (c))
+/** Distance between two samples of a channel in the window */
+#define WIN_STRIDE (ADC_ACQ_NUM_CHANNELS * ADC_ACQ_DECIMATION)
+/** Capture stamp of scan i of the window thread B is averaging (cycles) */
+#define WIN_TIME(i) win.time
+#else
+/** Element of the A -> B channel: one scan of every channel */
+struct scan {
+    uint16_t v[ADC_ACQ_NUM_CHANNELS];   /* Sample of each channel, maybe ADC_ACQ_INVALID */
+    uint32_t time;                      /* Capture stamp of its block (k_cycle_get_32()) */
+};
+/** Sample of channel c in scan i of the window thread B is averaging */
+#define WIN_SAMPLE(i, c) (win[i].v[c])
+/** Distance between two samples of a channel in the window */
+#define WIN_STRIDE (int)(sizeof(struct scan) / sizeof(uint16_t))
+/** Capture stamp of scan i of the window thread B is averaging (cycles) */
+#define WIN_TIME(i) (win[i].time)
+#endif
+
+/** Element of the B -> C channel: one output of every channel */
+struct output {
+    int v[ADC_ACQ_NUM_CHANNELS];
+    uint32_t time;                      /* Capture stamp of the newest scan of the window */
+#if defined(CONFIG_APP_ACQ_ZERO_COPY)
+    struct adc_acq_block blk;           /* Block the outputs come from, released by thread C */
+#endif
+};
+
+/* Create channels. Thread B receives one filter window at a time, thread C
+ * one output. */
+#if defined(CONFIG_APP_ACQ_ZERO_COPY)
+CHANNEL_DEFINE(chan_ab, sizeof(struct adc_acq_block), 1, CHANNEL_DEPTH);
+#else
+CHANNEL_DEFINE(chan_ab, sizeof(struct scan), FILTER_WINDOW, CHANNEL_DEPTH);
+#endif
+CHANNEL_DEFINE(chan_bc, sizeof(struct output), 1, CHANNEL_DEPTH);
+
+#if defined(CONFIG_APP_ACQ_ZERO_COPY)
+/** Gives back the block of an A -> B element lost to overflow */
+static void drop_block(const void *elem)
+{
+    adc_acq_release(elem);
+}
+
+/** Gives back the block of a B -> C element lost to overflow */
+static void drop_output(const void *elem)
+{
+    adc_acq_release(&((const struct output *)elem)->blk);
+}
+#endif
+
+/** What thread C drives the LED with */
+enum led_mode {
+    LED_FOLLOW,         /* The filtered value of ADC_ACQ_LED_CHANNEL */
+    LED_SETPOINT,       /* A fixed setpoint, changed with button 2 */
+};
+
+/** Commands to thread C */
+enum led_cmd {
+    LED_CMD_MODE,       /* Switch between LED_FOLLOW and LED_SETPOINT */
+    LED_CMD_SETPOINT,   /* Raise the setpoint by LED_SETPOINT_STEP */
+};
+
+/* Button commands to thread C, one byte each */
+K_MSGQ_DEFINE(led_cmd_msgq, sizeof(uint8_t), 4, 1);
+
+#if defined(CONFIG_APP_LED_BUTTONS)
+static struct gpio_callback button_cb_data;
+
+/** Button interrupt: queues the command of the button for thread C */
+static void button_pressed(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+    static uint32_t last;
+    uint32_t now = k_uptime_get_32();
+    uint8_t cmd = (pins & BIT(BOARDBUT1)) ? LED_CMD_MODE : LED_CMD_SETPOINT;
+
+    if(now - last < BUTTON_DEBOUNCE_MS) {
+        return;
+    }
+    last = now;
+    /* Queue full: thread C has not caught up with the presses, drop it */
+    k_msgq_put(&led_cmd_msgq, &cmd, K_NO_WAIT);
+}
+
+/** Buttons 1 and 2 interrupt on press (active low, with pull-up) */
+static int buttons_init(void)
+{
+    const struct device *gpio0_dev = device_get_binding(DT_LABEL(GPIO0_NID));
+    int ret;
+
+    if (gpio0_dev == NULL) {
+        return -ENODEV;
+    }
+    for(int i = 0; i < 2; i++) {
+        gpio_pin_t pin = i ? BOARDBUT2 : BOARDBUT1;
+
+        ret = gpio_pin_configure(gpio0_dev, pin, GPIO_INPUT | GPIO_PULL_UP | GPIO_ACTIVE_LOW);
+        if (!ret) {
+            ret = gpio_pin_interrupt_configure(gpio0_dev, pin, GPIO_INT_EDGE_TO_ACTIVE);
+        }
+        if (ret) {
+            return ret;
+        }
+    }
+    gpio_init_callback(&button_cb_data, button_pressed, BIT(BOARDBUT1) | BIT(BOARDBUT2));
+    return gpio_add_callback(gpio0_dev, &button_cb_data);
+}
+#endif
+
+#if defined(CONFIG_APP_FILTER_CHAIN)
+/** Low-pass biquad, cut-off at a twentieth of the thread B input rate, Q = 0.707 */
+static const int16_t lowpass[5] = { 329, 658, 329, -25576, 10508 };
+
+/* Filter chain of the LED channel: the median takes the spikes out, the
+ * low-pass smooths what is left */
+static const struct filter_stage led_stages[] = {
+    FILTER_MEDIAN_STAGE(5),
+    FILTER_BIQUAD_STAGE(lowpass),
+};
+
+/* Filter chain of the other channels */
+static const struct filter_stage other_stages[] = {
+    FILTER_MA_STAGE(8),
+};
+
+/** Filter chain of each channel index */
+static const struct filter_chain chains[ADC_ACQ_NUM_CHANNELS] = {
+    [0 ... ADC_ACQ_NUM_CHANNELS - 1] = FILTER_CHAIN(other_stages),
+    [ADC_ACQ_LED_CHANNEL] = FILTER_CHAIN(led_stages),
+};
+
+#endif
+
+#if defined(CONFIG_APP_ACQ_TIMER)
+/** Timer expiry function (interrupt context): triggers one ADC scan every TIMER_INTERVAL_MSEC */
+static void my_timer_expiry(struct k_timer *timer)
+{
+    adc_acq_trigger();
+}
+#endif
+
+/* Thread code prototypes */
+void thread_A_code(void *, void *, void *);
+void thread_B_code(void *, void *, void *);
+void thread_C_code(void *, void *, void *);
+
+
+/** Main function */
+void main(void) {
+
+    int err = 0;
+
+    err = adc_acq_init();
+    if (err) {
+        printk("adc_acq_init() failed with error code %d\n", err);
+    }
+
+#if defined(CONFIG_APP_ACQ_TIMER)
+    k_timer_init(&my_timer, my_timer_expiry, NULL);
+#endif
+
+    /* Welcome message */
+    printk("\n\r IPC via %s example \n\r", CHANNEL_TRANSPORT);
+
+#if defined(CONFIG_APP_FILTER_BENCH)
+    filter_bench();
+#endif
+
+    /* Init channels */
+#if defined(CONFIG_APP_ACQ_ZERO_COPY)
+    channel_set_drop(&chan_ab, drop_block);
+    channel_set_drop(&chan_bc, drop_output);
+#endif
+    channel_init(&chan_ab);
+    channel_init(&chan_bc);
+
+    /* Timing of the tasks. B and C are released by the data they receive. */
+    periodic_init(&task_A, "A", thread_A_period, thread_A_phase, thread_A_deadline, PERIODIC_OVERRUN_DEFAULT);
+    periodic_init(&task_B, "B", 0, 0, thread_B_deadline, PERIODIC_OVERRUN_DEFAULT);
+    periodic_init(&task_C, "C", 0, 0, thread_C_deadline, PERIODIC_OVERRUN_DEFAULT);
+    latency_init(&adc_to_led, "ADC->LED");
+    rate_init(thread_A_period);
+
+    /* Create tasks */
+    thread_A_tid = k_thread_create(&thread_A_data, thread_A_stack,
+        K_THREAD_STACK_SIZEOF(thread_A_stack), thread_A_code,
+        NULL, NULL, NULL, thread_A_prio, 0, K_NO_WAIT);
+
+    thread_B_tid = k_thread_create(&thread_B_data, thread_B_stack,
+        K_THREAD_STACK_SIZEOF(thread_B_stack), thread_B_code,
+        NULL, NULL, NULL, thread_B_prio, 0, K_NO_WAIT);
+
+    thread_C_tid = k_thread_create(&thread_C_data, thread_C_stack,
+        K_THREAD_STACK_SIZEOF(thread_C_stack), thread_C_code,
+        NULL, NULL, NULL, thread_C_prio, 0, K_NO_WAIT);
+
+    return;
+
+}
+
+/** Hands one block of thread A down the pipeline: burst capture, print,
+ * then the scans (or the block itself with zero copy) to thread B. err is
+ * the result of the adc_acq_wait() that returned it. */
+static void thread_A_forward(struct adc_acq_block *blk, int err)
+{
+#if !defined(CONFIG_APP_ACQ_ZERO_COPY)
+    struct scan s;
+#endif
+
+    if(blk->invalid) {
+      printk("adc reading out of range (%d samples)\n\r", blk->invalid);
+    }
+    /* The burst capture sees every scan, at the full acquisition rate */
+    capture_feed(blk);
+
+    if(blk->count) {
+      TRACE("%d (A)->", ADC_ACQ_SAMPLE(blk, blk->count - 1, ADC_ACQ_LED_CHANNEL));
+    }
+
+#if defined(CONFIG_APP_ACQ_ZERO_COPY)
+    /* The block goes down the pipeline as it is; thread C releases it */
+    if(!err) {
+      channel_send(&chan_ab, blk);
+    }
+#else
+    /* Only one scan out of ADC_ACQ_DECIMATION goes down the pipeline.
+     * Invalid samples are forwarded flagged, thread B skips them. */
+    for(int k = 0; k < blk->count; k += ADC_ACQ_DECIMATION) {
+      memcpy(s.v, &ADC_ACQ_SAMPLE(blk, k, 0), sizeof(s.v));
+      s.time = blk->time;
+      channel_send(&chan_ab, &s);
+    }
+    if(!err) {
+      adc_acq_release(blk);
+    }
+#endif
+}
+
+/** Thread A code implementation.
+ * It reads a block of ADC scans and sends each scan, or with zero copy the
+ * block itself, to thread B. In async mode block N is sent while the
+ * SAADC converts block N+1. */
+void thread_A_code(void *argA , void *argB, void *argC)
+{
+    /* Other variables */
+    int err = 0;
+    long int nact = 0;
+    struct adc_acq_block blk;
+#if defined(CONFIG_APP_ACQ_ASYNC)
+    bool pending = false;       /* blk was read but not yet forwarded */
+    int pending_err = 0;
+#endif
+
+    /* First release */
+    if(!ADC_ACQ_SELF_PACED) {
+        periodic_start(&task_A);
+    }
+
+#if defined(CONFIG_APP_ACQ_TIMER)
+    /* Sampling instants come from my_timer; thread A only handles the blocks */
+    err=adc_acq_start();
+    k_timer_start(&my_timer, K_MSEC(TIMER_INTERVAL_MSEC), K_MSEC(TIMER_INTERVAL_MSEC));
+#endif
+
+    /* Thread loop */
+    while(1) {
+        err=adc_acq_start();
+
+#if defined(CONFIG_APP_ACQ_ASYNC)
+        /* The previous block goes down the pipeline while the SAADC
+         * acquires and converts the new one */
+        if(pending) {
+          thread_A_forward(&blk, pending_err);
+          pending = false;
+        }
+#endif
+        nact++;
+
+        if(!err) {
+          err=adc_acq_wait(&blk);
+        }
+        /* A self-paced job is released by the arrival of its block */
+        if(ADC_ACQ_SELF_PACED) {
+          periodic_job_release(&task_A);
+        }
+        if(err) {
+          printk("adc_sample() failed with error code %d\n\r",err);
+          blk.count = 0;
+          blk.invalid = 0;
+        }
+
+#if defined(CONFIG_APP_ACQ_ASYNC)
+        /* Forwarded after the next conversion is started */
+        pending = true;
+        pending_err = err;
+#else
+        thread_A_forward(&blk, err);
+#endif
+
+        /* In block, hardware-timed and timer modes the acquisition sets the pace */
+        if(ADC_ACQ_SELF_PACED) {
+          periodic_job_done(&task_A);
+          continue;
+        }
+
+        /* Thread B may have changed the period (adaptive rate) */
+        if(IS_ENABLED(CONFIG_APP_RATE_ADAPTIVE)) {
+          periodic_set_period(&task_A, rate_period_ms());
+        }
+
+        /* Wait for next release instant, not counted as thread A load */
+        adc_acq_idle_begin();
+        periodic_wait_next(&task_A);
+        adc_acq_idle_end();
+    }
+}
+
+/** Thread B code implementation.
+ * It gets FILTER_WINDOW ADC values of each channel, does the average (or
+ * updates the moving average, running median or filter chain) and sends
+ * it to thread C. */
+void thread_B_code(void *argA , void *argB, void *argC)
+{
+    /* Local variables */
+    long int nact = 0;
+#if defined(CONFIG_APP_ACQ_ZERO_COPY)
+    struct adc_acq_block win;               /* One window: a block, by reference */
+#else
+    struct scan win[FILTER_WINDOW];         /* One window of scans */
+#endif
+    struct output res;
+    int out[ADC_ACQ_NUM_CHANNELS] = {0};    /* Last output of each channel */
+    int64_t last_report = k_uptime_get();   /* Uptime of the previous report */
+    uint32_t outputs = 0;                   /* Outputs since the previous report */
+    uint32_t latency_max = 0;               /* Longest window latency since then (ms) */
+    uint32_t waits = chan_ab.waits;         /* chan_ab.waits at the previous report */
+#if defined(CONFIG_APP_FILTER_MOVING_AVERAGE)
+    static uint16_t ma_buf[ADC_ACQ_NUM_CHANNELS][FILTER_MA_LENGTH];
+    struct filter_ma ma[ADC_ACQ_NUM_CHANNELS];  /* Moving average of each channel */
+
+    for(int c = 0; c < ADC_ACQ_NUM_CHANNELS; c++) {
+      filter_ma_init(&ma[c], ma_buf[c], FILTER_MA_LENGTH);
+    }
+#elif defined(CONFIG_APP_FILTER_MEDIAN)
+    static uint16_t med_hist[ADC_ACQ_NUM_CHANNELS][FILTER_MEDIAN_BINS];
+    static uint16_t med_buf[ADC_ACQ_NUM_CHANNELS][FILTER_MEDIAN_LENGTH];
+    struct filter_median med[ADC_ACQ_NUM_CHANNELS];    /* Running median of each channel */
+
+    for(int c = 0; c < ADC_ACQ_NUM_CHANNELS; c++) {
+      filter_median_init(&med[c], med_hist[c], med_buf[c], FILTER_MEDIAN_LENGTH);
+    }
+#elif defined(CONFIG_APP_FILTER_CHAIN)
+    for(int c = 0; c < ADC_ACQ_NUM_CHANNELS; c++) {
+      filter_chain_init(&chains[c]);
+    }
+#endif
+
+    while(1) {
+        channel_recv(&chan_ab, &win, K_FOREVER);
+        periodic_job_release(&task_B);
+
+        TRACE("\nCalculo do valor final (Thread B)\n");
+        int var_max = 0;        /* Largest window variance over the channels */
+        int slope_max = 0;      /* Largest output change over the channels */
+
+        for(int c = 0; c < ADC_ACQ_NUM_CHANNELS; c++){
+          int avg = 0;
+          int var = 0;
+          int nvalid = 0;
+
+          /* Window variance, the activity measure of the adaptive rate */
+          if(IS_ENABLED(CONFIG_APP_RATE_ADAPTIVE)) {
+            for(int i = 0; i < FILTER_WINDOW; i++){
+              avg += WIN_SAMPLE(i, c) * ADC_ACQ_VALID(WIN_SAMPLE(i, c));
+              nvalid += ADC_ACQ_VALID(WIN_SAMPLE(i, c));
+            }
+            avg = avg/MAX(nvalid, 1);
+            for(int i = 0; i < FILTER_WINDOW; i++){
+              var += (WIN_SAMPLE(i, c) - avg) * (WIN_SAMPLE(i, c) - avg) * ADC_ACQ_VALID(WIN_SAMPLE(i, c));
+            }
+            var_max = MAX(var_max, var/MAX(nvalid, 1));
+          }
+
+#if defined(CONFIG_APP_FILTER_MOVING_AVERAGE)
+          /* The new value enters the running sum, the oldest one leaves.
+           * No valid value yet: keep the previous output */
+          if(filter_ma_update(&ma[c], WIN_SAMPLE(0, c), &avg) == 0) {
+#elif defined(CONFIG_APP_FILTER_MEDIAN)
+          /* The new value enters the histogram, the oldest one leaves.
+           * No valid value yet: keep the previous output */
+          if(filter_median_update(&med[c], WIN_SAMPLE(0, c), &avg) == 0) {
+#elif defined(CONFIG_APP_FILTER_CHAIN)
+          /* The values of the window go through the stages of their
+           * channel, a block at a time. No valid value: keep the previous output */
+          if(filter_chain_run_block(&chains[c], c, &WIN_SAMPLE(0, c), FILTER_WINDOW, WIN_STRIDE, &avg) == 0) {
+#else
+          /* Mean of the values within the band around the window mean, or
+           * of all of them if none is (a window split between two levels).
+           * No valid value in the window: keep the previous output */
+          int kept = filter_band_mean(&WIN_SAMPLE(0, c), FILTER_WINDOW, WIN_STRIDE, FILTER_BAND_PM, &avg);
+
+          if(kept < 0) {
+            printk("Nenhum valor na banda (Thread B, canal %d), media de %d valores\n", c, -kept);
+          }
+          if(kept == 0) {
+#endif
+            printk("Sem valores validos (Thread B, canal %d)\n", c);
+            res.v[c] = out[c];
+            continue;
+          }
+
+          slope_max = MAX(slope_max, abs(avg - out[c]));
+          out[c] = avg;
+          res.v[c] = out[c];
+        }
+        rate_update(var_max, slope_max);
+
+        res.time = WIN_TIME(FILTER_WINDOW - 1);
+#if defined(CONFIG_APP_ACQ_ZERO_COPY)
+        /* The block travels on with its outputs */
+        res.blk = win;
+#endif
+        channel_send(&chan_bc, &res);
+
+        /* Throughput and latency of the outputs, to compare software
+         * averaging against hardware oversampling. Reported periodically:
+         * a line per output would fill the UART at block rates. */
+        int64_t now = k_uptime_get();
+
+        outputs++;
+        latency_max = MAX(latency_max, k_cyc_to_ms_floor32(k_cycle_get_32() - WIN_TIME(0)));
+        if(now - last_report >= thread_B_report_period) {
+          /* Two context switches (out and back in) per blocking wait */
+          uint32_t period_waits = chan_ab.waits - waits;
+
+          printk("B: %d values x 2^%d conversions, output every %u ms, window latency up to %u ms\n",
+                 FILTER_SPAN, CONFIG_APP_ACQ_OVERSAMPLING,
+                 (uint32_t)(now - last_report) / outputs, latency_max);
+          printk("B: %u context switches in %u outputs (%u waits)\n",
+                 2 * period_waits, outputs, period_waits);
+          last_report = now;
+          outputs = 0;
+          latency_max = 0;
+          waits = chan_ab.waits;
+        }
+        periodic_job_done(&task_B);
+    }
+}
+
+/** Thread C code implementation.
+ * It waits in one k_poll() for the averages, the button commands and a
+ * refresh timeout, and drives LED 1 with the average of the LED channel or
+ * with the setpoint, ramping towards it. Without new averages it keeps the
+ * last value. */
+void thread_C_code(void *argA , void *argB, void *argC)
+{
+    /* Local variables */
+    struct output res;
+    const struct device *pwm0_dev;          /* Pointer to PWM device structure */
+    int pwm0_channel  = 13;                 /* Ouput pin associated to pwm channel. See DTS for pwm channel - output pin association */
+    unsigned int pwmPeriod_us = 1000;       /* PWM period in us */
+    int ret = 0;
+    long int nact = 0;
+    struct k_poll_event events[2];          /* New output of thread B, button command */
+    uint8_t cmd;
+    enum led_mode mode = LED_FOLLOW;
+    int target = 0;                         /* Last average of the LED channel */
+    int setpoint = 0;                       /* LED value in LED_SETPOINT mode */
+    int led = -1;                           /* Value on the LED, -1 before the first one */
+    int goal;
+    bool fresh;                             /* New outputs in this wake-up */
+    bool held = false;                      /* Missing outputs already reported */
+    k_ticks_t refresh_period = k_ms_to_ticks_ceil64(CONFIG_APP_LED_REFRESH_MS);
+    k_ticks_t hold = k_ms_to_ticks_ceil64(CONFIG_APP_LED_HOLD_MS);
+    int64_t refresh;                        /* Next refresh (ticks) */
+    int64_t last_value;                     /* Arrival of the last output (ticks) */
+    int64_t report;                         /* Next latency report (ticks) */
+    int64_t now;
+
+    pwm0_dev = device_get_binding(DT_LABEL(PWM0_NID));
+    if (pwm0_dev == NULL) {
+	printk("Error: PWM device %s is not ready\n", pwm0_dev->name);
+	return;
+    }
+    else  {
+        printk("PWM device %s is ready\n", pwm0_dev->name);
+    }
+
+#if defined(CONFIG_APP_LED_BUTTONS)
+    ret = buttons_init();
+    if (ret) {
+        printk("Error %d: buttons not available\n", ret);
+    }
+#endif
+
+    channel_poll_init(&chan_bc, &events[0]);
+    k_poll_event_init(&events[1], K_POLL_TYPE_MSGQ_DATA_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY, &led_cmd_msgq);
+    last_value = k_uptime_ticks();
+    refresh = last_value + refresh_period;
+    report = last_value + k_ms_to_ticks_ceil64(CONFIG_APP_LED_LATENCY_REPORT_MS);
+
+    while(1) {
+        /* A new output, a command or the next refresh, whichever comes first */
+        channel_poll_arm(&chan_bc, &events[0]);
+        events[1].state = K_POLL_STATE_NOT_READY;
+        k_poll(events, ARRAY_SIZE(events), K_TIMEOUT_ABS_TICKS(refresh));
+
+        fresh = false;
+        while(events[0].state != K_POLL_STATE_NOT_READY && channel_recv(&chan_bc, &res, K_NO_WAIT) == 0) {
+          if(!fresh) {
+            periodic_job_release(&task_C);
+          }
+          fresh = true;
+
+          for(int c = 0; c < ADC_ACQ_NUM_CHANNELS; c++) {
+            if(c != ADC_ACQ_LED_CHANNEL) {
+              TRACE("Valor canal %d: %d (Thread C)\n", c, res.v[c]);
+            }
+          }
+          target = res.v[ADC_ACQ_LED_CHANNEL];
+          if(mode == LED_FOLLOW) {
+            TRACE("Atribuir valor a LED: %d (Thread C)\n", target);
+          }
+#if defined(CONFIG_APP_ACQ_ZERO_COPY)
+          /* Last stage: the block goes back to the acquisition */
+          adc_acq_release(&res.blk);
+#endif
+        }
+        now = k_uptime_ticks();
+        if(fresh) {
+          last_value = now;
+          held = false;
+        }
+
+        while(events[1].state != K_POLL_STATE_NOT_READY && k_msgq_get(&led_cmd_msgq, &cmd, K_NO_WAIT) == 0) {
+          if(cmd == LED_CMD_MODE) {
+            mode = (mode == LED_FOLLOW) ? LED_SETPOINT : LED_FOLLOW;
+            printk("Modo do LED: %s (Thread C)\n", mode == LED_FOLLOW ? "valor filtrado" : "setpoint");
+          } else {
+            setpoint = (setpoint >= LED_MAX) ? 0 : MIN(setpoint + LED_SETPOINT_STEP, LED_MAX);
+            printk("Setpoint do LED: %d (Thread C)\n", setpoint);
+          }
+        }
+
+        goal = (mode == LED_FOLLOW) ? target : setpoint;
+        if(now >= refresh) {
+          /* Refreshes missed while the thread was held up are skipped */
+          refresh += refresh_period * ((now - refresh) / refresh_period + 1);
+
+          if(mode == LED_FOLLOW && !held && now - last_value >= hold) {
+            printk("Sem valores novos ha %u ms, LED mantido em %d (Thread C)\n",
+                   (uint32_t)k_ticks_to_ms_floor64(now - last_value), led);
+            held = true;
+          }
+          /* One ramp step per refresh */
+          if(CONFIG_APP_LED_RAMP_STEP && led >= 0) {
+            goal = led + CLAMP(goal - led, -CONFIG_APP_LED_RAMP_STEP, CONFIG_APP_LED_RAMP_STEP);
+          }
+        } else if(CONFIG_APP_LED_RAMP_STEP && led >= 0) {
+          /* The ramp only moves at the refreshes */
+          goal = led;
+        }
+
+        if(goal != led) {
+          ret = pwm_pin_set_usec(pwm0_dev, pwm0_channel, pwmPeriod_us,(unsigned int)((pwmPeriod_us*goal)/LED_MAX), PWM_POLARITY_NORMAL);
+          if (ret) {
+            printk("Error %d: failed to set pulse width\n", ret);
+            return;
+          }
+          led = goal;
+        }
+
+        if(!fresh) {
+          continue;
+        }
+        /* The newest sample behind the value now driving the LED */
+        if(mode == LED_FOLLOW) {
+          latency_record(&adc_to_led, res.time);
+        }
+        periodic_job_done(&task_C);
+
+        /* Deadline misses and channel fill levels of the whole pipeline,
+         * printed only when they change */
+        periodic_report(&task_A);
+        periodic_report(&task_B);
+        periodic_report(&task_C);
+        channel_report(&chan_ab);
+        channel_report(&chan_bc);
+
+        if(CONFIG_APP_LED_LATENCY_REPORT_MS && now >= report) {
+          latency_report(&adc_to_led);
+          report = now + k_ms_to_ticks_ceil64(CONFIG_APP_LED_LATENCY_REPORT_MS);
+        }
+  }
+}
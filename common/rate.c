@@ -0,0 +1,56 @@
+/** @file rate.c
+ * @brief Adaptive sampling rate controller implementation.
+ *
+ * Fast attack, slow release: one active window is enough to go to the
+ * minimum period, while each step back up needs a full hold time of quiet
+ * windows. The hold is measured in time, not in windows, so the number of
+ * channels reporting does not change the decay.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <sys/atomic.h>
+
+#include "rate.h"
+
+/** Thread A period (ms), written by thread B and read by thread A */
+static atomic_t rate_period;
+/** Uptime of the last activity or period step (ms) */
+static int64_t rate_last_step;
+
+void rate_init(uint32_t period_ms)
+{
+    atomic_set(&rate_period, CLAMP(period_ms, CONFIG_APP_RATE_MIN_PERIOD_MS,
+                                   CONFIG_APP_RATE_MAX_PERIOD_MS));
+    rate_last_step = k_uptime_get();
+}
+
+void rate_update(int variance, int slope)
+{
+    int64_t now = k_uptime_get();
+    uint32_t period = (uint32_t)atomic_get(&rate_period);
+    uint32_t next = period;
+
+    if (variance > CONFIG_APP_RATE_VARIANCE_THRESHOLD ||
+        slope > CONFIG_APP_RATE_SLOPE_THRESHOLD || slope < -CONFIG_APP_RATE_SLOPE_THRESHOLD) {
+        next = CONFIG_APP_RATE_MIN_PERIOD_MS;
+        rate_last_step = now;
+    } else if (now - rate_last_step >= CONFIG_APP_RATE_HOLD_MS) {
+        next = MIN(period * 2, CONFIG_APP_RATE_MAX_PERIOD_MS);
+        rate_last_step = now;
+    }
+
+    if (next != period) {
+        atomic_set(&rate_period, next);
+        printk("Rate: thread A period %u -> %u ms (variance %d, slope %d)\n",
+               period, next, variance, slope);
+    }
+}
+
+uint32_t rate_period_ms(void)
+{
+    return (uint32_t)atomic_get(&rate_period);
+}
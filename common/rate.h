@@ -0,0 +1,39 @@
+/** @file rate.h
+ * @brief Adaptive sampling rate controller.
+ *
+ * Thread B reports the activity of each filter window with rate_update();
+ * thread A reads the resulting period with rate_period_ms() at every
+ * release. The period drops to the minimum as soon as the variance or the
+ * slope goes above its threshold, and doubles after every
+ * CONFIG_APP_RATE_HOLD_MS of quiet signal, up to the maximum.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#ifndef RATE_H
+#define RATE_H
+
+#include <zephyr.h>
+
+#if defined(CONFIG_APP_RATE_ADAPTIVE)
+
+/** Sets the starting period (ms), clamped to the configured bounds */
+void rate_init(uint32_t period_ms);
+
+/** Feeds the variance (codes squared) and the change from the previous
+ * output (codes) of one window. Can be called once per channel. */
+void rate_update(int variance, int slope);
+
+/** Current thread A period (ms) */
+uint32_t rate_period_ms(void);
+
+#else
+
+static inline void rate_init(uint32_t period_ms) { }
+static inline void rate_update(int variance, int slope) { }
+static inline uint32_t rate_period_ms(void) { return 0; }
+
+#endif /* CONFIG_APP_RATE_ADAPTIVE */
+
+#endif /* RATE_H */
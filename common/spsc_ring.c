@@ -0,0 +1,84 @@
+/** @file spsc_ring.c
+ * @brief Lock-free single-producer/single-consumer ring implementation.
+ *
+ * Publishing relies on atomic_set() being a full barrier: the samples are
+ * written before head moves, and read before tail moves.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#include <zephyr.h>
+#include <sys/atomic.h>
+#include <sys/__assert.h>
+
+#include "spsc_ring.h"
+
+void spsc_ring_init(struct spsc_ring *r, uint16_t *buf, uint32_t size, uint32_t watermark)
+{
+    __ASSERT(IS_POWER_OF_TWO(size), "ring size must be a power of two");
+    __ASSERT(watermark > 0 && watermark <= size, "watermark out of range");
+
+    r->buf = buf;
+    r->mask = size - 1;
+    r->watermark = watermark;
+    atomic_set(&r->head, 0);
+    atomic_set(&r->tail, 0);
+    atomic_set(&r->waiting, 0);
+    k_sem_init(&r->sem, 0, 1);
+    r->max_fill = 0;
+}
+
+uint32_t spsc_ring_push(struct spsc_ring *r, const uint16_t *data, uint32_t n)
+{
+    uint32_t head = (uint32_t)atomic_get(&r->head);
+    uint32_t fill = head - (uint32_t)atomic_get(&r->tail);
+
+    if(r->mask + 1 - fill < n) {
+        return 0;
+    }
+    for(uint32_t i = 0; i < n; i++) {
+        r->buf[(head + i) & r->mask] = data[i];
+    }
+    atomic_set(&r->head, (atomic_val_t)(head + n));
+
+    fill += n;
+    if(fill > r->max_fill) {
+        r->max_fill = fill;
+    }
+    /* The consumer does not move tail while it sleeps, so fill is exact here */
+    if(fill >= r->watermark && atomic_cas(&r->waiting, 1, 0)) {
+        k_sem_give(&r->sem);
+    }
+    return n;
+}
+
+uint32_t spsc_ring_pop(struct spsc_ring *r, uint16_t *data, uint32_t n)
+{
+    uint32_t tail = (uint32_t)atomic_get(&r->tail);
+
+    n = MIN(n, (uint32_t)atomic_get(&r->head) - tail);
+    for(uint32_t i = 0; i < n; i++) {
+        data[i] = r->buf[(tail + i) & r->mask];
+    }
+    atomic_set(&r->tail, (atomic_val_t)(tail + n));
+    return n;
+}
+
+int spsc_ring_wait(struct spsc_ring *r, k_timeout_t timeout)
+{
+    while(spsc_ring_fill(r) < r->watermark) {
+        atomic_set(&r->waiting, 1);
+        /* The producer may have crossed the watermark before it saw the flag */
+        if(spsc_ring_fill(r) >= r->watermark) {
+            atomic_clear(&r->waiting);
+            break;
+        }
+        /* A wake-up left over from a previous wait only costs one more check */
+        if(k_sem_take(&r->sem, timeout)) {
+            atomic_clear(&r->waiting);
+            return -EAGAIN;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+/** @file spsc_ring.h
+ * @brief Lock-free single-producer/single-consumer ring of 16-bit samples.
+ *
+ * The producer only writes head and the consumer only writes tail, so
+ * neither side takes a lock or masks interrupts; both indices run freely
+ * and are reduced with the size mask on access. Pushes are all or nothing,
+ * so a batch (e.g. one ADC scan) is never split.
+ *
+ * The consumer does not get a wake-up per sample: spsc_ring_wait() only
+ * sleeps on a semaphore, and the producer only gives it, when the fill
+ * level crosses the watermark while the consumer is waiting.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <zephyr.h>
+#include <sys/atomic.h>
+
+/** Ring state. Fields other than the atomics belong to one side only. */
+struct spsc_ring {
+    uint16_t *buf;
+    uint32_t mask;          /* Size - 1, the size is a power of two */
+    uint32_t watermark;     /* Fill level that wakes the consumer */
+    atomic_t head;          /* Samples pushed (written by the producer) */
+    atomic_t tail;          /* Samples popped (written by the consumer) */
+    atomic_t waiting;       /* Set while the consumer sleeps on sem */
+    struct k_sem sem;
+    uint32_t max_fill;      /* High-water mark of the fill level (producer) */
+};
+
+/** Sets up an empty ring over buf. size must be a power of two and
+ * watermark at most size. */
+void spsc_ring_init(struct spsc_ring *r, uint16_t *buf, uint32_t size, uint32_t watermark);
+
+/** Producer: appends n samples, or none if they do not all fit.
+ * Returns the number of samples pushed. Safe from interrupt context. */
+uint32_t spsc_ring_push(struct spsc_ring *r, const uint16_t *data, uint32_t n);
+
+/** Consumer: removes up to n samples. Returns the number of samples popped. */
+uint32_t spsc_ring_pop(struct spsc_ring *r, uint16_t *data, uint32_t n);
+
+/** Consumer: waits until at least watermark samples are in the ring.
+ * Returns 0, or -EAGAIN on timeout. */
+int spsc_ring_wait(struct spsc_ring *r, k_timeout_t timeout);
+
+/** Samples currently in the ring */
+static inline uint32_t spsc_ring_fill(struct spsc_ring *r)
+{
+    return (uint32_t)atomic_get(&r->head) - (uint32_t)atomic_get(&r->tail);
+}
+
+#endif /* SPSC_RING_H */
@@ -0,0 +1,48 @@
+/** @file triple_buf.c
+ * @brief Lock-free triple buffer implementation.
+ *
+ * atomic_set() returns the previous value, so it is used as an atomic
+ * exchange; it is also a full barrier, which orders the slot contents
+ * with the index that publishes them.
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <sys/atomic.h>
+
+#include "triple_buf.h"
+
+void triple_buf_init(struct triple_buf *tb, void *mem, size_t size)
+{
+    tb->mem = mem;
+    tb->size = size;
+    memcpy(tb->mem + size, tb->mem, size);
+    memcpy(tb->mem + 2 * size, tb->mem, size);
+    tb->write = 0;
+    tb->read = 1;
+    atomic_set(&tb->shared, 2);
+}
+
+bool triple_buf_publish(struct triple_buf *tb)
+{
+    atomic_val_t old = atomic_set(&tb->shared, tb->write | TRIPLE_BUF_FRESH);
+
+    tb->write = (uint8_t)(old & ~TRIPLE_BUF_FRESH);
+    return (old & TRIPLE_BUF_FRESH) != 0;
+}
+
+const void *triple_buf_read(struct triple_buf *tb, bool *fresh)
+{
+    bool is_fresh = (atomic_get(&tb->shared) & TRIPLE_BUF_FRESH) != 0;
+
+    if(is_fresh) {
+        tb->read = (uint8_t)(atomic_set(&tb->shared, tb->read) & ~TRIPLE_BUF_FRESH);
+    }
+    if(fresh) {
+        *fresh = is_fresh;
+    }
+    return tb->mem + tb->read * tb->size;
+}
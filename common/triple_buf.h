@@ -0,0 +1,52 @@
+/** @file triple_buf.h
+ * @brief Lock-free triple buffer for latest-value exchange between two threads.
+ *
+ * Three slots: the writer owns one, the reader owns one and the third
+ * holds the last published value. Publishing and picking up are a single
+ * atomic exchange of the shared slot index, so neither side ever waits for
+ * the other, the writer never touches the slot being read and the reader
+ * always sees a complete value. Values that are overwritten before the
+ * reader picks them up are lost (latest value wins).
+ *
+ * @author Bruno Feitais
+ * @date 2022/05
+ */
+
+#ifndef TRIPLE_BUF_H
+#define TRIPLE_BUF_H
+
+#include <zephyr.h>
+#include <sys/atomic.h>
+
+/** Triple buffer over three slots of size bytes each */
+struct triple_buf {
+    uint8_t *mem;           /* 3 * size bytes */
+    size_t size;
+    atomic_t shared;        /* Index of the shared slot, TRIPLE_BUF_FRESH if unread */
+    uint8_t write;          /* Slot owned by the writer */
+    uint8_t read;           /* Slot owned by the reader */
+};
+
+/** Set in shared when the shared slot was published and not yet picked up */
+#define TRIPLE_BUF_FRESH 0x4
+
+/** Sets up the buffer over mem (3 * size bytes). All slots start as copies of
+ * mem's first slot, so the reader gets a defined value before the first publish. */
+void triple_buf_init(struct triple_buf *tb, void *mem, size_t size);
+
+/** Writer: slot to fill. Its contents are stale (an older value). */
+static inline void *triple_buf_write_ptr(struct triple_buf *tb)
+{
+    return tb->mem + tb->write * tb->size;
+}
+
+/** Writer: publishes the slot from triple_buf_write_ptr() and takes a new one.
+ * Returns true if the previous value was never picked up; it is then the
+ * contents of the new writer slot. */
+bool triple_buf_publish(struct triple_buf *tb);
+
+/** Reader: latest published value. The slot stays valid until the next call.
+ * fresh (optional) tells whether it was published since the previous call. */
+const void *triple_buf_read(struct triple_buf *tb, bool *fresh);
+
+#endif /* TRIPLE_BUF_H */